@@ -0,0 +1,206 @@
+/*
+ * copyright: 2016
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Starts many requests with a timeout at once against a minimal HTTP server running on the
+ * loopback interface and prints the throughput and the latency percentiles of the requests.
+ *
+ * The server waits "delay" milliseconds before it answers a request so that many requests
+ * are pending at the same time.Each request is for a different URL unless "shared" is 1,then
+ * all of them are for the same URL and share the requests that are in flight.
+ *
+ * usage: networkAccessManager_benchmark [number of requests] [delay] [shared]
+ */
+
+#include "networkAccessManager.hpp"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QUrl>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+static void _serve( QTcpServer& server,int delay,int& served )
+{
+	QObject::connect( &server,&QTcpServer::newConnection,[ &server,delay,&served ](){
+
+		while( server.hasPendingConnections() ){
+
+			auto socket = server.nextPendingConnection() ;
+
+			auto buffer = std::make_shared< QByteArray >() ;
+
+			QObject::connect( socket,&QTcpSocket::disconnected,socket,&QTcpSocket::deleteLater ) ;
+
+			QObject::connect( socket,&QTcpSocket::readyRead,[ socket,buffer,delay,&served ](){
+
+				*buffer += socket->readAll() ;
+
+				while( true ){
+
+					auto m = buffer->indexOf( "\r\n\r\n" ) ;
+
+					if( m == -1 ){
+
+						break ;
+					}
+
+					buffer->remove( 0,m + 4 ) ;
+
+					served++ ;
+
+					QTimer::singleShot( delay,socket,[ socket ](){
+
+						socket->write( "HTTP/1.1 200 OK\r\n"
+							       "Content-Type: text/plain\r\n"
+							       "Content-Length: 2\r\n"
+							       "Connection: keep-alive\r\n\r\n"
+							       "ok" ) ;
+					} ) ;
+				}
+			} ) ;
+		}
+	} ) ;
+}
+
+static double _percentile( const std::vector< qint64 >& e,int s )
+{
+	auto index = ( e.size() - 1 ) * static_cast< std::size_t >( s ) / 100 ;
+
+	return static_cast< double >( e[ index ] ) / 1000000 ;
+}
+
+int main( int argc,char * argv[] )
+{
+	QCoreApplication app( argc,argv ) ;
+
+	int count = argc > 1 ? std::atoi( argv[ 1 ] ) : 10000 ;
+	int delay = argc > 2 ? std::atoi( argv[ 2 ] ) : 1 ;
+	bool shared = argc > 3 && std::atoi( argv[ 3 ] ) == 1 ;
+
+	if( count < 1 ){
+
+		count = 10000 ;
+	}
+
+	QTcpServer server ;
+
+	if( !server.listen( QHostAddress::LocalHost ) ){
+
+		std::printf( "failed to start a server on the loopback interface\n" ) ;
+		return 1 ;
+	}
+
+	int served = 0 ;
+
+	_serve( server,delay,served ) ;
+
+	auto url = QString( "http://127.0.0.1:%1/" ).arg( server.serverPort() ) ;
+
+	NetworkAccessManager manager ;
+
+	std::vector< qint64 > latencies ;
+
+	latencies.reserve( static_cast< std::size_t >( count ) ) ;
+
+	int failed = 0 ;
+	int timedOut = 0 ;
+	int done = 0 ;
+
+	QElapsedTimer timer ;
+
+	timer.start() ;
+
+	for( int i = 0 ; i < count ; i++ ){
+
+		auto start = timer.nsecsElapsed() ;
+
+		QNetworkRequest request( QUrl( shared ? url : url + QString::number( i ) ) ) ;
+
+		manager.get( 30,request,[ &,start ]( QNetworkReply& e ){
+
+			latencies.emplace_back( timer.nsecsElapsed() - start ) ;
+
+			if( e.error() != QNetworkReply::NoError || e.readAll() != "ok" ){
+
+				failed++ ;
+			}
+
+			if( ++done == count ){
+
+				app.quit() ;
+			}
+
+		},[ & ](){
+
+			timedOut++ ;
+
+			if( ++done == count ){
+
+				app.quit() ;
+			}
+		} ) ;
+	}
+
+	auto queued = timer.nsecsElapsed() ;
+
+	app.exec() ;
+
+	auto elapsed = static_cast< double >( timer.nsecsElapsed() ) / 1000000000 ;
+
+	std::printf( "%d requests,%d ms server delay,%s URLs\n\n",count,delay,shared ? "shared" : "distinct" ) ;
+	std::printf( "starting all requests: %.1f ms\n",static_cast< double >( queued ) / 1000000 ) ;
+	std::printf( "total:                 %.2f s\n",elapsed ) ;
+	std::printf( "throughput:            %.0f requests/s\n",count / elapsed ) ;
+	std::printf( "failed:                %d\n",failed ) ;
+	std::printf( "timed out:             %d\n",timedOut ) ;
+	std::printf( "sent to the server:    %d\n",served ) ;
+
+	if( !latencies.empty() ){
+
+		std::sort( latencies.begin(),latencies.end() ) ;
+
+		std::printf( "\nlatency in milliseconds\n\n" ) ;
+		std::printf( "%10s %10s %10s %10s\n","p50","p90","p99","max" ) ;
+		std::printf( "%10.1f %10.1f %10.1f %10.1f\n",
+			     _percentile( latencies,50 ),
+			     _percentile( latencies,90 ),
+			     _percentile( latencies,99 ),
+			     _percentile( latencies,100 ) ) ;
+	}
+
+	return 0 ;
+}
@@ -37,60 +37,86 @@
 
 #include <QEventLoop>
 #include <QTimer>
+#include <QFile>
+#include <QDir>
+#include <QHash>
+#include <QCryptographicHash>
+#include <QUrlQuery>
+#include <QStringList>
 
 #include <vector>
+#include <list>
+#include <deque>
+#include <array>
+#include <unordered_map>
 #include <functional>
 #include <utility>
 #include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
 
-class NetworkAccessManagerTimeOutManager : public QObject
+/*
+ * A copy of a finished reply given to callers that shared a request,each one can read the body.
+ */
+class NetworkAccessManagerSharedReply : public QNetworkReply
 {
-	Q_OBJECT
 public:
-	NetworkAccessManagerTimeOutManager( std::function< bool( QNetworkReply * ) > e,
-					    std::function< void() > s,
-					    QNetworkReply * m,
-					    int w,
-					    QObject * n ) :
-		m_object( n ),
-		m_reply( m ),
-		m_cancel( std::move( e ) ),
-		m_timeout( std::move( s ) )
+	NetworkAccessManagerSharedReply( QNetworkReply& e,const QByteArray& data ) : m_data( data )
 	{
-		connect( &m_timer,SIGNAL( timeout() ),
-			 this,SLOT( timeout() ),Qt::QueuedConnection ) ;
+		this->setRequest( e.request() ) ;
+		this->setUrl( e.url() ) ;
+		this->setOperation( e.operation() ) ;
+		this->setError( e.error(),e.errorString() ) ;
 
-		m_timer.start( 1000 * w ) ;
-	}
-private slots:
-	void timeout()
-	{
-		m_timer.stop() ;
+		for( const auto& it : e.rawHeaderPairs() ){
 
-		disconnect( m_object,SIGNAL( finished( QNetworkReply * ) ),
-			    this,SLOT( networkReply( QNetworkReply * ) ) ) ;
+			this->setRawHeader( it.first,it.second ) ;
+		}
 
-		m_cancel( m_reply ) ;
+		for( auto it : { QNetworkRequest::HttpStatusCodeAttribute,
+				 QNetworkRequest::HttpReasonPhraseAttribute,
+				 QNetworkRequest::RedirectionTargetAttribute,
+				 QNetworkRequest::SourceIsFromCacheAttribute } ){
 
-		m_timeout() ;
+			this->setAttribute( it,e.attribute( it ) ) ;
+		}
 
-		this->deleteLater() ;
+		this->open( QIODevice::ReadOnly | QIODevice::Unbuffered ) ;
+		this->setFinished( true ) ;
 	}
-	void networkReply( QNetworkReply * e )
+	void abort() override
+	{
+	}
+	bool isSequential() const override
+	{
+		return true ;
+	}
+	qint64 bytesAvailable() const override
+	{
+		return m_data.size() - m_position + QNetworkReply::bytesAvailable() ;
+	}
+protected:
+	qint64 readData( char * data,qint64 max ) override
 	{
-		if( e == m_reply ){
+		auto s = std::min( max,static_cast< qint64 >( m_data.size() ) - m_position ) ;
+
+		if( s <= 0 ){
 
-			m_timer.stop() ;
-			this->deleteLater() ;
+			return -1 ;
 		}
+
+		std::memcpy( data,m_data.constData() + m_position,static_cast< std::size_t >( s ) ) ;
+
+		m_position += s ;
+
+		return s ;
 	}
 private:
-	QObject * m_object ;
-	QNetworkReply * m_reply ;
-	QTimer m_timer ;
-	std::function< bool( QNetworkReply * ) > m_cancel ;
-	std::function< void() > m_timeout ;
-} ;
+	QByteArray m_data ;
+	qint64 m_position = 0 ;
+};
 
 class NetworkAccessManager : public QObject
 {
@@ -98,32 +124,446 @@ class NetworkAccessManager : public QObject
 public:
 	using NetworkReply = std::unique_ptr< QNetworkReply,void( * )( QNetworkReply * ) > ;
 	using function_t   = std::function< void( QNetworkReply& ) > ;
+
+	enum class downloadResult{ finished,failed,timedOut,checksumMismatch,fileError } ;
+
+	/*
+	 * The expected hash of a downloaded file as a hex string,an empty one is not checked.
+	 */
+	struct checksum
+	{
+		checksum()
+		{
+		}
+		checksum( QCryptographicHash::Algorithm a,const QByteArray& h ) : algorithm( a ),hex( h )
+		{
+		}
+		QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha256 ;
+		QByteArray hex ;
+	};
 private:
-	using entries_t = std::vector< std::tuple< QNetworkReply *,bool,function_t > > ;
+	/*
+	 * Deadlines of all callers are kept in a single timing wheel driven by one timer.
+	 * A caller that times out after "n" ticks is put in the slot "n" positions ahead
+	 * of the current one and the number of full turns of the wheel it has to wait is
+	 * kept in "rounds".
+	 */
+	static const int m_tickInterval = 250 ;
+	static const std::size_t m_slotCount = 256 ;
+
+	struct flight ;
+	struct waiter ;
+
+	using slot_t = std::list< waiter * > ;
+
+	/*
+	 * A caller of a request.Identical GET requests made while one is in flight share it and
+	 * each caller keeps its own callback and timeout.
+	 */
+	struct waiter
+	{
+		waiter( flight * e,function_t f ) : owner( e ),function( std::move( f ) )
+		{
+		}
+		flight * owner ;
+		function_t function ;
+		std::function< void() > timeOut ;
+		bool hasTimeOut = false ;
+		std::size_t slot = 0 ;
+		std::size_t rounds = 0 ;
+		slot_t::iterator position ;
+	};
+
+	/*
+	 * A request.It has no reply while it is queued or waits to be retried and "key" is set
+	 * when later callers can share it.
+	 */
+	struct flight
+	{
+		QNetworkReply * reply = nullptr ;
+		std::function< QNetworkReply *() > send ;
+		bool deleteReply = true ;
+		bool retryable = false ;
+		bool queued = false ;
+		int priority = 1 ;
+		QString host ;
+		QNetworkRequest request ;
+		QByteArray key ;
+		int attempt = 0 ;
+		std::function< bool( QNetworkReply& ) > data ;
+		std::list< waiter > waiters ;
+	};
+
+	using flight_t = std::shared_ptr< flight > ;
+
+	/*
+	 * Requests to a host that wait for one of its connections,one queue per priority class.
+	 */
+	struct host
+	{
+		int active = 0 ;
+		std::array< std::deque< flight_t >,3 > queues ;
+	};
+
+	using entries_t = std::unordered_map< QNetworkReply *,flight_t > ;
+	using validators_t = std::pair< QByteArray,QByteArray > ;
+	using clock_type = std::chrono::steady_clock ;
+
+	struct breaker
+	{
+		int failures = 0 ;
+		clock_type::time_point openUntil ;
+	};
+
 	entries_t m_entries ;
+	QHash< QByteArray,flight_t > m_flights ;
+	QHash< QString,host > m_hosts ;
+	int m_hostLimit = 6 ;
+	qint64 m_downloadRate = 0 ;
+	double m_downloadTokens = 0 ;
+	clock_type::time_point m_downloadRefill ;
+	int m_retryAttempts = 1 ;
+	int m_retryBaseDelay = 500 ;
+	int m_retryMaxDelay = 30000 ;
+	int m_breakerFailures = 0 ;
+	int m_breakerCoolDown = 0 ;
+	QHash< QString,breaker > m_breakers ;
+	std::mt19937 m_random ;
+	QString m_cacheDirectory ;
+	QHash< QByteArray,validators_t > m_validators ;
+	QStringList m_validatorsIgnoredQueryItems ;
+	std::vector< slot_t > m_wheel ;
+	std::size_t m_currentSlot = 0 ;
+	std::size_t m_timedEntries = 0 ;
+	QTimer m_timer ;
 	QNetworkAccessManager m_manager ;
-
-	using position_t = decltype( m_entries.size() ) ;
 public:
-	NetworkAccessManager()
+	NetworkAccessManager() : m_random( std::random_device()() ),m_wheel( m_slotCount )
 	{
 		connect( &m_manager,SIGNAL( finished( QNetworkReply * ) ),
 			 this,SLOT( networkReply( QNetworkReply * ) ),Qt::QueuedConnection ) ;
+
+		connect( &m_timer,SIGNAL( timeout() ),this,SLOT( tick() ) ) ;
+
+		m_timer.setInterval( m_tickInterval ) ;
 	}
 	QNetworkAccessManager& QtNAM()
 	{
 		return m_manager ;
 	}
+	/*
+	 * No more than "e" requests to the same host are sent at a time,the rest wait in the order
+	 * of the priority of their QNetworkRequest,HighPriority first and LowPriority last,and in
+	 * the order they were made within a priority.
+	 */
+	void setHostConnectionLimit( int e )
+	{
+		m_hostLimit = std::max( e,1 ) ;
+
+		for( const auto& it : m_hosts.keys() ){
+
+			this->dispatch( it ) ;
+		}
+	}
+	/*
+	 * GET and HEAD requests made with a callback that fail with a network error,a 429 or a 5xx
+	 * status are sent again until they were tried "attempts" times.The wait before the n-th retry
+	 * is a random number of milliseconds between 0 and min( maxDelay,baseDelay * 2^n ) and a retry
+	 * that would end after the timeout of the request is not made.A retry is sent with a new
+	 * QNetworkReply and the one returned when the request was made is deleted.
+	 */
+	void setRetryPolicy( int attempts,int baseDelay = 500,int maxDelay = 30000 )
+	{
+		m_retryAttempts  = std::max( attempts,1 ) ;
+		m_retryBaseDelay = std::max( baseDelay,1 ) ;
+		m_retryMaxDelay  = std::max( maxDelay,m_retryBaseDelay ) ;
+	}
+	/*
+	 * After "failures" requests in a row to a host failed or timed out,requests made with a
+	 * callback to the host are not sent for "coolDown" milliseconds and their timeout function
+	 * is called right away instead.The first request after the cool down decides if the host
+	 * is used again or if it is skipped for another cool down.0 failures turns this off.
+	 */
+	void setCircuitBreaker( int failures,int coolDown )
+	{
+		m_breakerFailures = std::max( failures,0 ) ;
+		m_breakerCoolDown = std::max( coolDown,0 ) ;
+		m_breakers.clear() ;
+	}
+	/*
+	 * Remember the ETag and Last-Modified headers of successful GET replies in "e" so that
+	 * getIfModified() can ask the server to only send a resource that changed.
+	 */
+	void setCacheDirectory( const QString& e )
+	{
+		QDir().mkpath( e ) ;
+
+		m_cacheDirectory = e ;
+		m_validators.clear() ;
+	}
+	/*
+	 * Query items named "e" are left out of the URL validators are remembered for,ie a cursor
+	 * that changes with every request and would otherwise leave a file behind for every value.
+	 */
+	void ignoreQueryItemInValidators( const QString& e )
+	{
+		if( !m_validatorsIgnoredQueryItems.contains( e ) ){
+
+			m_validatorsIgnoredQueryItems.append( e ) ;
+
+			m_validators.clear() ;
+		}
+	}
+	/*
+	 * Like get() but sends If-None-Match and If-Modified-Since headers made from the last
+	 * successful reply for the same URL.A reply for which notModified() returns true carries
+	 * no body and means nothing changed since then.
+	 */
+	QNetworkReply * getIfModified( int timeOut,const QNetworkRequest& r,function_t f,
+				       std::function< void() > m = [](){} )
+	{
+		return this->get( timeOut,this->ifModified( r ),std::move( f ),std::move( m ) ) ;
+	}
+	/*
+	 * Returns a copy of "r" with the headers getIfModified() adds.
+	 */
+	QNetworkRequest ifModified( QNetworkRequest r )
+	{
+		const auto& e = this->validators( r.url() ) ;
+
+		if( !e.first.isEmpty() ){
+
+			r.setRawHeader( "If-None-Match",e.first ) ;
+		}
+
+		if( !e.second.isEmpty() ){
+
+			r.setRawHeader( "If-Modified-Since",e.second ) ;
+		}
+
+		return r ;
+	}
+	/*
+	 * Like get() but "data" is called every time a part of the body arrives so that it can
+	 * be processed without waiting for all of it.Returning false from "data" aborts the
+	 * request and "f" is called right away.
+	 */
+	QNetworkReply * getStream( int timeOut,const QNetworkRequest& r,std::function< bool( QNetworkReply& ) > data,
+				   function_t f,std::function< void() > m = [](){} )
+	{
+		if( this->skip( r,m ) ){
+
+			return nullptr ;
+		}
+
+		auto s = this->add( [ this,r ](){ return m_manager.get( r ) ; },r,true,std::move( f ),timeOut * 1000,std::move( m ) ) ;
+
+		s->retryable = true ;
+		s->data      = std::move( data ) ;
+
+		this->enqueue( s ) ;
+
+		return s->reply ;
+	}
+	/*
+	 * Downloads "r" to "path" without keeping more than a small buffer of it in memory.
+	 *
+	 * The body is written to "path.part" and a part left by an earlier download that failed or
+	 * timed out is resumed with a Range request,the server sends the whole file again if it
+	 * changed since.A part without the ETag or Last-Modified of the response it came from is
+	 * discarded and the download starts from the beginning.When "c" has a hash,the file is checked against it and a file that does not
+	 * match is deleted.The part is renamed to "path" once it is complete.
+	 *
+	 * "progress" is called with the number of bytes written so far,including the resumed part,
+	 * and the size of the file or -1 if it is not known.A download is never retried,calling
+	 * download() again resumes it.
+	 */
+	void download( int timeOut,const QNetworkRequest& r,const QString& path,
+		       std::function< void( downloadResult ) > f,
+		       std::function< void( qint64,qint64 ) > progress = nullptr,
+		       const checksum& c = checksum() )
+	{
+		auto s = std::make_shared< downloadState >( path,c,std::move( f ),std::move( progress ) ) ;
+
+		if( !s->file.open( QIODevice::ReadWrite ) ){
+
+			QTimer::singleShot( 0,this,[ this,s ](){ this->report( *s,downloadResult::fileError ) ; } ) ;
+
+			return ;
+		}
+
+		s->received = s->file.size() ;
+
+		QNetworkRequest request( r ) ;
+
+		if( s->received > 0 ){
+
+			QByteArray e ;
+
+			QFile v( s->path + ".part.validator" ) ;
+
+			if( v.open( QIODevice::ReadOnly ) ){
+
+				e = v.readLine().trimmed() ;
+			}
+
+			if( e.isEmpty() ){
+
+				/*
+				 * without a validator a Range request could splice a newer file onto
+				 * the old part,start over
+				 */
+				s->file.resize( 0 ) ;
+				s->received = 0 ;
+			}else{
+				request.setRawHeader( "Range","bytes=" + QByteArray::number( s->received ) + "-" ) ;
+				request.setRawHeader( "If-Range",e ) ;
+			}
+
+			if( s->received > 0 && !s->expected.hex.isEmpty() ){
+
+				while( !s->file.atEnd() ){
+
+					s->hash.addData( s->file.read( m_downloadChunk ) ) ;
+				}
+			}
+		}
+
+		s->file.seek( s->received ) ;
+
+		auto m = [ this,s ](){
+
+			s->reply = nullptr ;
+
+			this->report( *s,downloadResult::timedOut ) ;
+		} ;
+
+		if( this->skip( request,m ) ){
+
+			return ;
+		}
+
+		auto send = [ this,request ](){
+
+			auto e = m_manager.get( request ) ;
+
+			e->setReadBufferSize( m_downloadChunk ) ;
+
+			return e ;
+		} ;
+
+		auto function = [ this,s ]( QNetworkReply& e ){
+
+			s->reply = nullptr ;
+
+			this->downloaded( *s,e ) ;
+		} ;
+
+		auto e = this->add( std::move( send ),request,true,std::move( function ),timeOut * 1000,std::move( m ) ) ;
+
+		e->data = [ this,s ]( QNetworkReply& e ){
+
+			return this->downloading( s,e ) ;
+		} ;
+
+		this->enqueue( e ) ;
+	}
+	/*
+	 * Limits all downloads made with download() to a total of "e" bytes per second,0 removes
+	 * the limit.
+	 */
+	void setDownloadRateLimit( qint64 e )
+	{
+		m_downloadRate   = std::max( e,static_cast< qint64 >( 0 ) ) ;
+		m_downloadTokens = static_cast< double >( m_downloadRate ) ;
+		m_downloadRefill = clock_type::now() ;
+	}
+	/*
+	 * Moves a request for "r" that waits for a connection up to priority "e",ie when the result
+	 * of a background request is now waited for by the user.Nothing happens when it was sent.
+	 */
+	void raisePriority( const QNetworkRequest& r,QNetworkRequest::Priority e )
+	{
+		auto it = m_hosts.find( r.url().host() ) ;
+
+		if( it == m_hosts.end() ){
+
+			return ;
+		}
+
+		QNetworkRequest m( r ) ;
+
+		m.setPriority( e ) ;
+
+		auto key = NetworkAccessManager::key( r ) ;
+
+		for( const auto& queue : it.value().queues ){
+
+			for( const auto& s : queue ){
+
+				if( s->queued && NetworkAccessManager::key( s->request ) == key ){
+
+					auto x = s ;
+
+					this->moveUp( x,NetworkAccessManager::priority( m ) ) ;
+
+					return ;
+				}
+			}
+		}
+	}
+	static bool notModified( QNetworkReply& e )
+	{
+		return e.attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() == 304 ;
+	}
+	/*
+	 * The functions that take a callback return nullptr when the circuit breaker of the host
+	 * is open,the timeout function is then called from the event loop,and when the request
+	 * is queued because the host has no free connection.
+	 *
+	 * A GET request made while one with the same URL and headers is in flight is not sent,the
+	 * caller waits for the reply of the earlier one.Each caller gets its own callback,called with
+	 * a copy of the reply when there is more than one,and its own timeout.The returned reply is
+	 * the shared one and cancelling it cancels it for every caller,when more than one caller
+	 * waits on it the timeout function of each one is called from the event loop so that none
+	 * of them waits forever.
+	 */
 	QNetworkReply * get( int timeOut,const QNetworkRequest& r,function_t f,
 						 std::function< void() > m = [](){} )
 	{
-		auto s = m_manager.get( r ) ;
+		auto key = NetworkAccessManager::key( r ) ;
 
-		m_entries.emplace_back( s,true,std::move( f ) ) ;
+		auto it = m_flights.find( key ) ;
 
-		this->setTimeOut( timeOut,s,std::move( m ) ) ;
+		if( it != m_flights.end() ){
 
-		return s ;
+			auto& s = *it.value() ;
+
+			this->wait( s,std::move( f ),timeOut * 1000,std::move( m ) ) ;
+
+			/*
+			 * A queued request is moved up when a caller with a higher priority joins it
+			 */
+			this->moveUp( it.value(),NetworkAccessManager::priority( r ) ) ;
+
+			return s.reply ;
+		}
+
+		if( this->skip( r,m ) ){
+
+			return nullptr ;
+		}
+
+		auto s = this->add( [ this,r ](){ return m_manager.get( r ) ; },r,true,std::move( f ),timeOut * 1000,std::move( m ) ) ;
+
+		s->retryable = true ;
+		s->key       = key ;
+
+		m_flights.insert( key,s ) ;
+
+		this->enqueue( s ) ;
+
+		return s->reply ;
 	}
 	NetworkReply get( int timeOut,const QNetworkRequest& r,std::function< void() > m = [](){} )
 	{
@@ -131,13 +571,11 @@ public:
 
 		QEventLoop s ;
 
-		auto a = m_manager.get( r ) ;
-
 		auto function = [ & ]( QNetworkReply& e ){ q = std::addressof( e ) ; s.quit() ;	} ;
 
-		m_entries.emplace_back( std::make_tuple( a,false,std::move( function ) ) ) ;
+		auto a = [ this,r ](){ return m_manager.get( r ) ; } ;
 
-		this->setTimeOut( timeOut,a,std::move( m ) ) ;
+		this->enqueue( this->add( std::move( a ),r,false,std::move( function ),timeOut * 1000,std::move( m ) ) ) ;
 
 		s.exec() ;
 
@@ -147,13 +585,16 @@ public:
 	QNetworkReply * post( int timeOut,const QNetworkRequest& r,const T& e,function_t f,
 			      std::function< void() > m = [](){} )
 	{
-		auto s = m_manager.post( r,e ) ;
+		if( this->skip( r,m ) ){
+
+			return nullptr ;
+		}
 
-		m_entries.emplace_back( std::make_tuple( s,true,std::move( f ) ) ) ;
+		auto s = this->add( [ this,r,e ](){ return m_manager.post( r,e ) ; },r,true,std::move( f ),timeOut * 1000,std::move( m ) ) ;
 
-		this->setTimeOut( timeOut,s,std::move( m ) ) ;
+		this->enqueue( s ) ;
 
-		return s ;
+		return s->reply ;
 	}
 	template< typename T >
 	NetworkReply post( int timeOut,const QNetworkRequest& r,const T& e,
@@ -165,11 +606,9 @@ public:
 
 		auto function = [ & ]( QNetworkReply& e ){ q = std::addressof( e ) ; s.quit() ;	} ;
 
-		auto a = m_manager.post( r,e ) ;
+		auto a = [ this,r,e ](){ return m_manager.post( r,e ) ; } ;
 
-		m_entries.emplace_back( std::make_tuple( a,false,std::move( function ) ) ) ;
-
-		this->setTimeOut( timeOut,a,std::move( m ) ) ;
+		this->enqueue( this->add( std::move( a ),r,false,std::move( function ),timeOut * 1000,std::move( m ) ) ) ;
 
 		s.exec() ;
 
@@ -178,13 +617,18 @@ public:
 	QNetworkReply * head( int timeOut,const QNetworkRequest& r,function_t f,
 			      std::function< void() > m = [](){} )
 	{
-		auto s = m_manager.head( r ) ;
+		if( this->skip( r,m ) ){
+
+			return nullptr ;
+		}
 
-		m_entries.emplace_back( std::make_tuple( s,true,std::move( f ) ) ) ;
+		auto s = this->add( [ this,r ](){ return m_manager.head( r ) ; },r,true,std::move( f ),timeOut * 1000,std::move( m ) ) ;
 
-		this->setTimeOut( timeOut,s,std::move( m ) ) ;
+		s->retryable = true ;
 
-		return s ;
+		this->enqueue( s ) ;
+
+		return s->reply ;
 	}
 	NetworkReply head( int timeOut,const QNetworkRequest& r,std::function< void() > m = [](){} )
 	{
@@ -194,11 +638,9 @@ public:
 
 		auto function = [ & ]( QNetworkReply& e ){ q = std::addressof( e ) ; s.quit() ;	} ;
 
-		auto a = m_manager.head( r ) ;
-
-		m_entries.emplace_back( std::make_tuple( a,false,std::move( function ) ) ) ;
+		auto a = [ this,r ](){ return m_manager.head( r ) ; } ;
 
-		this->setTimeOut( timeOut,a,std::move( m ) ) ;
+		this->enqueue( this->add( std::move( a ),r,false,std::move( function ),timeOut * 1000,std::move( m ) ) ) ;
 
 		s.exec() ;
 
@@ -206,62 +648,1096 @@ public:
 	}
 	bool cancel( QNetworkReply * e )
 	{
-		return this->find_network_reply( e,[ this ]( QNetworkReply& e,position_t s ){
+		auto it = m_entries.find( e ) ;
+
+		if( it == m_entries.end() ){
+
+			return false ;
+		}
+
+		if( it->second->deleteReply ){
 
-			if( std::get< 1 >( m_entries[ s ] ) ){
+			e->deleteLater() ;
+		}
+
+		auto s = it->second ;
+
+		std::vector< std::function< void() > > m ;
+
+		if( s->waiters.size() > 1 ){
 
-				e.deleteLater() ;
+			for( auto& x : s->waiters ){
+
+				if( x.timeOut ){
+
+					m.emplace_back( std::move( x.timeOut ) ) ;
+				}
 			}
+		}
 
-			m_entries.erase( m_entries.begin() + s ) ;
+		this->release( *s ) ;
 
-			e.close() ;
-			e.abort() ;
-		} ) ;
+		m_entries.erase( it ) ;
+
+		this->done( s->host ) ;
+
+		e->close() ;
+		e->abort() ;
+
+		for( auto& x : m ){
+
+			QTimer::singleShot( 0,this,std::move( x ) ) ;
+		}
+
+		return true ;
 	}
 private:
-	void setTimeOut( int s,QNetworkReply * e,std::function< void() > m )
+	static QByteArray key( const QNetworkRequest& r )
+	{
+		auto s = r.rawHeaderList() ;
+
+		std::sort( s.begin(),s.end() ) ;
+
+		auto e = r.url().toEncoded() ;
+
+		for( const auto& it : s ){
+
+			e += "\n" + it + ":" + r.rawHeader( it ) ;
+		}
+
+		return e ;
+	}
+	static int priority( const QNetworkRequest& r )
+	{
+		switch( r.priority() ){
+
+		case QNetworkRequest::HighPriority :
+
+			return 0 ;
+
+		case QNetworkRequest::LowPriority :
+
+			return 2 ;
+
+		default :
+
+			return 1 ;
+		}
+	}
+	/*
+	 * "timeOut" is in milliseconds.The request is sent by enqueue().
+	 */
+	flight_t add( std::function< QNetworkReply *() > send,const QNetworkRequest& r,bool d,
+		      function_t f,int timeOut,std::function< void() > m )
+	{
+		auto s = std::make_shared< flight >() ;
+
+		s->send        = std::move( send ) ;
+		s->deleteReply = d ;
+		s->request     = r ;
+		s->host        = r.url().host() ;
+		s->priority    = NetworkAccessManager::priority( r ) ;
+
+		this->wait( *s,std::move( f ),timeOut,std::move( m ) ) ;
+
+		return s ;
+	}
+	/*
+	 * A queued request is moved up by adding it to the queue of priority "p",the entry left in
+	 * its old queue is skipped by dispatch().
+	 */
+	void moveUp( const flight_t& s,int p )
 	{
-		if( s > 0 ){
+		if( s->queued && p < s->priority ){
 
-			auto a = [ this ]( QNetworkReply * e ){	return this->cancel( e ) ; } ;
+			s->priority = p ;
 
-			auto u = new NetworkAccessManagerTimeOutManager( std::move( a ),
-									 std::move( m ),
-									 e,s,&m_manager ) ;
+			m_hosts[ s->host ].queues[ static_cast< std::size_t >( p ) ].push_back( s ) ;
 
-			connect( &m_manager,SIGNAL( finished( QNetworkReply * ) ),
-				 u,SLOT( networkReply( QNetworkReply * ) ),Qt::QueuedConnection ) ;
+			this->dispatch( s->host ) ;
 		}
 	}
-	bool find_network_reply( QNetworkReply * e,std::function< void( QNetworkReply&,position_t ) > function )
+	void enqueue( const flight_t& s )
+	{
+		s->queued = true ;
+
+		m_hosts[ s->host ].queues[ static_cast< std::size_t >( s->priority ) ].push_back( s ) ;
+
+		this->dispatch( s->host ) ;
+	}
+	/*
+	 * Sends queued requests to "e" while it has free connections.A request can be in a queue
+	 * more than once,ie after it was moved up,and is only sent the first time it comes up.
+	 */
+	void dispatch( const QString& e )
 	{
-		for( position_t s = 0 ; s < m_entries.size() ; s++ ){
+		auto it = m_hosts.find( e ) ;
+
+		if( it == m_hosts.end() ){
+
+			return ;
+		}
+
+		auto& h = it.value() ;
+
+		while( h.active < m_hostLimit ){
+
+			flight_t s ;
+
+			for( auto& queue : h.queues ){
+
+				while( !s && !queue.empty() ){
+
+					auto m = std::move( queue.front() ) ;
+
+					queue.pop_front() ;
+
+					if( m->queued && !m->waiters.empty() ){
+
+						s = std::move( m ) ;
+					}
+				}
+
+				if( s ){
+
+					break ;
+				}
+			}
 
-			if( std::get< 0 >( m_entries[ s ] ) == e ){
+			if( !s ){
 
-				function( *e,s ) ;
+				break ;
+			}
+
+			s->queued = false ;
+
+			auto reply = s->send() ;
+
+			s->reply = reply ;
 
-				return true ;
+			m_entries.emplace( reply,s ) ;
+
+			h.active++ ;
+
+			if( s->data ){
+
+				this->stream( reply ) ;
 			}
 		}
 
-		return false ;
+		if( h.active == 0 ){
+
+			m_hosts.erase( it ) ;
+		}
 	}
-private slots:
-	void networkReply( QNetworkReply * e )
+	/*
+	 * Called when a request to "e" stopped using a connection.
+	 */
+	void done( const QString& e )
+	{
+		auto it = m_hosts.find( e ) ;
+
+		if( it != m_hosts.end() ){
+
+			it.value().active-- ;
+
+			this->dispatch( e ) ;
+		}
+	}
+	void wait( flight& e,function_t f,int timeOut,std::function< void() > m )
 	{
-		this->find_network_reply( e,[ this ]( QNetworkReply& e,position_t s ){
+		e.waiters.emplace_back( &e,std::move( f ) ) ;
+
+		auto& s = e.waiters.back() ;
+
+		/*
+		 * Kept even without a timeout,it is also called when a shared request is cancelled
+		 */
+		s.timeOut = std::move( m ) ;
+
+		if( timeOut > 0 ){
+
+			/*
+			 * One more tick because the first one comes after less than a full interval
+			 */
+			auto ticks = ( static_cast< std::size_t >( timeOut ) + m_tickInterval - 1 ) / m_tickInterval + 1 ;
+
+			s.hasTimeOut = true ;
+			s.slot       = ( m_currentSlot + ticks ) % m_slotCount ;
+			s.rounds     = ( ticks - 1 ) / m_slotCount ;
+
+			auto& slot = m_wheel[ s.slot ] ;
 
-			std::get< 2 >( m_entries[ s ] )( e ) ;
+			s.position = slot.insert( slot.end(),&s ) ;
 
-			if( std::get< 1 >( m_entries[ s ] ) ){
+			if( m_timedEntries++ == 0 ){
 
-				e.deleteLater() ;
+				m_timer.start() ;
 			}
+		}
+	}
+	void unwait( waiter& s )
+	{
+		if( s.hasTimeOut ){
 
-			m_entries.erase( m_entries.begin() + s ) ;
-		} ) ;
+			s.hasTimeOut = false ;
+
+			m_wheel[ s.slot ].erase( s.position ) ;
+
+			if( --m_timedEntries == 0 ){
+
+				m_timer.stop() ;
+			}
+		}
+	}
+	/*
+	 * Stops later callers from sharing "s".
+	 */
+	void unlink( flight& s )
+	{
+		if( !s.key.isEmpty() ){
+
+			auto it = m_flights.find( s.key ) ;
+
+			if( it != m_flights.end() && it.value().get() == &s ){
+
+				m_flights.erase( it ) ;
+			}
+
+			s.key.clear() ;
+		}
+	}
+	/*
+	 * Takes all callers off "s" and returns their callbacks.
+	 */
+	std::vector< function_t > release( flight& s )
+	{
+		std::vector< function_t > e ;
+
+		for( auto& it : s.waiters ){
+
+			this->unwait( it ) ;
+
+			e.emplace_back( std::move( it.function ) ) ;
+		}
+
+		s.waiters.clear() ;
+
+		this->unlink( s ) ;
+
+		return e ;
+	}
+	/*
+	 * Calls the timeout functions of all callers of "s",ie when it can not be sent.
+	 */
+	void expire( flight& s )
+	{
+		std::vector< std::function< void() > > e ;
+
+		for( auto& it : s.waiters ){
+
+			auto m = it.hasTimeOut ;
+
+			this->unwait( it ) ;
+
+			if( m ){
+
+				e.emplace_back( std::move( it.timeOut ) ) ;
+			}
+		}
+
+		s.waiters.clear() ;
+
+		this->unlink( s ) ;
+
+		for( auto& it : e ){
+
+			it() ;
+		}
+	}
+	/*
+	 * Drops a request all of whose callers timed out.
+	 */
+	void abandon( flight& s )
+	{
+		this->unlink( s ) ;
+
+		if( s.queued ){
+
+			/*
+			 * It is dropped from its queue when it comes up
+			 */
+			s.queued = false ;
+
+		}else if( s.reply ){
+
+			auto e = s.reply ;
+			auto d = s.deleteReply ;
+			auto host = s.host ;
+
+			this->failure( host ) ;
+
+			m_entries.erase( e ) ;
+
+			this->done( host ) ;
+
+			if( d ){
+
+				e->deleteLater() ;
+			}
+
+			e->close() ;
+			e->abort() ;
+		}else{
+			this->failure( s.host ) ;
+		}
+	}
+	bool isOpen( const QString& host ) const
+	{
+		if( m_breakerFailures == 0 ){
+
+			return false ;
+		}
+
+		auto it = m_breakers.find( host ) ;
+
+		if( it == m_breakers.end() ){
+
+			return false ;
+		}
+
+		return it.value().failures >= m_breakerFailures && clock_type::now() < it.value().openUntil ;
+	}
+	/*
+	 * Returns true and arranges for "m" to be called if the breaker of the host of "r" is open.
+	 * Once the cool down passed one request is let through and the breaker stays open for
+	 * everything else until that request finished.
+	 */
+	bool skip( const QNetworkRequest& r,const std::function< void() >& m )
+	{
+		auto host = r.url().host() ;
+
+		if( this->isOpen( host ) ){
+
+			QTimer::singleShot( 0,this,m ) ;
+
+			return true ;
+		}
+
+		if( m_breakerFailures > 0 ){
+
+			auto it = m_breakers.find( host ) ;
+
+			if( it != m_breakers.end() && it.value().failures >= m_breakerFailures ){
+
+				it.value().openUntil = clock_type::now() + std::chrono::milliseconds( m_breakerCoolDown ) ;
+			}
+		}
+
+		return false ;
+	}
+	void failure( const QString& host )
+	{
+		if( m_breakerFailures > 0 ){
+
+			auto& s = m_breakers[ host ] ;
+
+			if( ++s.failures >= m_breakerFailures ){
+
+				s.openUntil = clock_type::now() + std::chrono::milliseconds( m_breakerCoolDown ) ;
+			}
+		}
+	}
+	void success( const QString& host )
+	{
+		if( m_breakerFailures > 0 ){
+
+			m_breakers.remove( host ) ;
+		}
+	}
+	void stream( QNetworkReply * e )
+	{
+		connect( e,&QNetworkReply::readyRead,this,[ this,e ](){ this->readyRead( e ) ; } ) ;
+	}
+	/*
+	 * Milliseconds left before the last caller of "e" times out,ignoring the part of the
+	 * current tick that passed,or -1 if a caller has no timeout.
+	 */
+	int timeLeft( const flight& e ) const
+	{
+		int m = 0 ;
+
+		for( const auto& s : e.waiters ){
+
+			if( !s.hasTimeOut ){
+
+				return -1 ;
+			}
+
+			auto ticks = ( s.slot + m_slotCount - m_currentSlot ) % m_slotCount + s.rounds * m_slotCount ;
+
+			m = std::max( m,static_cast< int >( ticks ) * m_tickInterval ) ;
+		}
+
+		return m ;
+	}
+	static bool failed( QNetworkReply& e )
+	{
+		auto s = e.attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() ;
+
+		if( s == 0 ){
+
+			return e.error() != QNetworkReply::NoError ;
+		}else{
+			return s == 429 || s >= 500 ;
+		}
+	}
+	bool canRetry( const flight& s,QNetworkReply& e )
+	{
+		if( !s.retryable || s.attempt + 1 >= m_retryAttempts ){
+
+			return false ;
+		}
+
+		return NetworkAccessManager::failed( e ) && !this->isOpen( s.host ) ;
+	}
+	/*
+	 * Sends the request of a failed reply again after a backoff.Its callers keep waiting and
+	 * new callers can still share it.Returns false if the callers should get the failed reply
+	 * instead.
+	 */
+	bool retry( entries_t::iterator it,QNetworkReply * e )
+	{
+		auto s = it->second ;
+
+		if( !this->canRetry( *s,*e ) ){
+
+			return false ;
+		}
+
+		auto cap = std::min( static_cast< qint64 >( m_retryMaxDelay ),
+				     static_cast< qint64 >( m_retryBaseDelay ) << std::min( s->attempt,20 ) ) ;
+
+		auto delay = static_cast< int >( std::uniform_int_distribution< qint64 >( 0,cap )( m_random ) ) ;
+
+		auto timeLeft = this->timeLeft( *s ) ;
+
+		if( timeLeft >= 0 && delay >= timeLeft ){
+
+			return false ;
+		}
+
+		s->reply = nullptr ;
+		s->attempt++ ;
+
+		m_entries.erase( it ) ;
+
+		this->done( s->host ) ;
+
+		e->deleteLater() ;
+
+		QTimer::singleShot( delay,this,[ this,s ](){
+
+			/*
+			 * All callers may have timed out while waiting
+			 */
+			if( s->waiters.empty() ){
+
+				return ;
+			}
+
+			if( this->skip( s->request,[ this,s ](){ this->expire( *s ) ; } ) ){
+
+				return ;
+			}
+
+			this->enqueue( s ) ;
+		} ) ;
+
+		return true ;
+	}
+	static const int m_downloadChunk = 64 * 1024 ;
+
+	struct downloadState
+	{
+		downloadState( const QString& p,const checksum& c,std::function< void( downloadResult ) > f,
+			       std::function< void( qint64,qint64 ) > s ) :
+			path( p ),file( p + ".part" ),expected( c ),hash( c.algorithm ),
+			function( std::move( f ) ),progress( std::move( s ) )
+		{
+		}
+		QString path ;
+		QFile file ;
+		checksum expected ;
+		QCryptographicHash hash ;
+		std::function< void( downloadResult ) > function ;
+		std::function< void( qint64,qint64 ) > progress ;
+		QNetworkReply * reply = nullptr ;
+		qint64 received = 0 ;
+		qint64 total = -1 ;
+		bool started = false ;
+		bool failed = false ;
+		bool fileError = false ;
+		bool complete = false ;
+		bool waiting = false ;
+		bool reported = false ;
+	};
+	using download_t = std::shared_ptr< downloadState > ;
+
+	void report( downloadState& s,downloadResult e )
+	{
+		if( !s.reported ){
+
+			s.reported = true ;
+
+			s.file.close() ;
+
+			if( s.function ){
+
+				s.function( e ) ;
+			}
+		}
+	}
+	/*
+	 * Takes up to "e" bytes from the token bucket of download().The bucket holds at most one
+	 * second worth of bytes.
+	 */
+	qint64 tokens( qint64 e )
+	{
+		if( m_downloadRate == 0 ){
+
+			return e ;
+		}
+
+		auto now = clock_type::now() ;
+
+		auto s = std::chrono::duration< double >( now - m_downloadRefill ).count() ;
+
+		m_downloadRefill = now ;
+
+		m_downloadTokens = std::min( static_cast< double >( m_downloadRate ),m_downloadTokens + s * static_cast< double >( m_downloadRate ) ) ;
+
+		auto m = std::min( e,static_cast< qint64 >( m_downloadTokens ) ) ;
+
+		m_downloadTokens -= static_cast< double >( m ) ;
+
+		return m ;
+	}
+	/*
+	 * Milliseconds until the token bucket has "e" bytes.
+	 */
+	int tokensIn( qint64 e ) const
+	{
+		auto s = static_cast< double >( std::min( e,m_downloadRate ) ) - m_downloadTokens ;
+
+		return std::max( 1,static_cast< int >( s * 1000 / static_cast< double >( m_downloadRate ) ) + 1 ) ;
+	}
+	bool write( downloadState& s,const QByteArray& e )
+	{
+		if( s.file.write( e ) != e.size() ){
+
+			s.fileError = true ;
+
+			return false ;
+		}
+
+		if( !s.expected.hex.isEmpty() ){
+
+			s.hash.addData( e ) ;
+		}
+
+		s.received += e.size() ;
+
+		return true ;
+	}
+	/*
+	 * Decides what to do with the part file from the status of the first reply.
+	 */
+	bool start( downloadState& s,QNetworkReply& e )
+	{
+		s.started = true ;
+
+		auto status = e.attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() ;
+
+		if( status == 206 ){
+
+			/*
+			 * Content-Range: bytes <first>-<last>/<size or *>
+			 */
+			auto range = e.rawHeader( "Content-Range" ) ;
+
+			auto m = range.indexOf( ' ' ) ;
+			auto n = range.indexOf( '-' ) ;
+			auto k = range.indexOf( '/' ) ;
+
+			if( m == -1 || n == -1 || k == -1 || range.mid( m + 1,n - m - 1 ).toLongLong() != s.received ){
+
+				s.failed = true ;
+
+				return false ;
+			}
+
+			bool ok ;
+
+			auto total = range.mid( k + 1 ).toLongLong( &ok ) ;
+
+			s.total = ok ? total : -1 ;
+
+		}else if( status == 416 ){
+
+			/*
+			 * The part already has the whole file
+			 */
+			s.complete = true ;
+
+			return true ;
+
+		}else if( status == 200 || status == 0 ){
+
+			if( s.received > 0 ){
+
+				s.file.resize( 0 ) ;
+				s.file.seek( 0 ) ;
+
+				s.hash.reset() ;
+
+				s.received = 0 ;
+			}
+
+			auto size = e.header( QNetworkRequest::ContentLengthHeader ) ;
+
+			s.total = size.isValid() ? size.toLongLong() : -1 ;
+		}else{
+			s.failed = true ;
+
+			return false ;
+		}
+
+		QFile f( s.path + ".part.validator" ) ;
+
+		auto validator = e.rawHeader( "ETag" ) ;
+
+		if( validator.isEmpty() || validator.startsWith( "W/" ) ){
+
+			validator = e.rawHeader( "Last-Modified" ) ;
+		}
+
+		if( validator.isEmpty() ){
+
+			f.remove() ;
+
+		}else if( f.open( QIODevice::WriteOnly | QIODevice::Truncate ) ){
+
+			f.write( validator + "\n" ) ;
+		}
+
+		return true ;
+	}
+	/*
+	 * Moves what the token bucket allows from "e" to the part file.
+	 */
+	bool pump( const download_t& s,QNetworkReply& e )
+	{
+		while( e.bytesAvailable() > 0 ){
+
+			auto m = this->tokens( std::min( e.bytesAvailable(),static_cast< qint64 >( m_downloadChunk ) ) ) ;
+
+			if( m == 0 ){
+
+				if( !s->waiting ){
+
+					s->waiting = true ;
+
+					QTimer::singleShot( this->tokensIn( m_downloadChunk ),this,[ this,s ](){
+
+						s->waiting = false ;
+
+						if( s->reply && !this->pump( s,*s->reply ) ){
+
+							auto e = s->reply ;
+
+							s->reply = nullptr ;
+
+							this->cancel( e ) ;
+
+							this->report( *s,downloadResult::fileError ) ;
+						}
+					} ) ;
+				}
+
+				break ;
+			}
+
+			if( !this->write( *s,e.read( m ) ) ){
+
+				return false ;
+			}
+		}
+
+		if( s->progress ){
+
+			s->progress( s->received,s->total ) ;
+		}
+
+		return true ;
+	}
+	bool downloading( const download_t& s,QNetworkReply& e )
+	{
+		s->reply = &e ;
+
+		if( !s->started && !this->start( *s,e ) ){
+
+			return false ;
+		}
+
+		if( s->complete ){
+
+			return true ;
+		}
+
+		if( !this->pump( s,e ) ){
+
+			s->reply = nullptr ;
+
+			this->report( *s,downloadResult::fileError ) ;
+
+			return false ;
+		}
+
+		return true ;
+	}
+	void downloaded( downloadState& s,QNetworkReply& e )
+	{
+		if( !s.started && !this->start( s,e ) ){
+
+			return this->report( s,downloadResult::failed ) ;
+		}
+
+		if( s.failed || s.fileError ){
+
+			return this->report( s,s.failed ? downloadResult::failed : downloadResult::fileError ) ;
+		}
+
+		if( !s.complete ){
+
+			if( e.error() != QNetworkReply::NoError ){
+
+				/*
+				 * The part is kept and the next download() resumes it
+				 */
+				return this->report( s,downloadResult::failed ) ;
+			}
+
+			/*
+			 * The rest of the body is already in memory,there is nothing to throttle
+			 */
+			while( e.bytesAvailable() > 0 ){
+
+				if( !this->write( s,e.read( m_downloadChunk ) ) ){
+
+					return this->report( s,downloadResult::fileError ) ;
+				}
+			}
+
+			if( s.progress ){
+
+				s.progress( s.received,s.total ) ;
+			}
+
+			if( s.total != -1 && s.received != s.total ){
+
+				return this->report( s,downloadResult::failed ) ;
+			}
+		}
+
+		if( !s.file.flush() ){
+
+			return this->report( s,downloadResult::fileError ) ;
+		}
+
+		if( !s.expected.hex.isEmpty() ){
+
+			if( s.complete ){
+
+				s.hash.reset() ;
+
+				s.file.seek( 0 ) ;
+
+				while( !s.file.atEnd() ){
+
+					s.hash.addData( s.file.read( m_downloadChunk ) ) ;
+				}
+			}
+
+			if( s.hash.result().toHex().toLower() != s.expected.hex.toLower() ){
+
+				s.file.close() ;
+				s.file.remove() ;
+
+				QFile::remove( s.path + ".part.validator" ) ;
+
+				return this->report( s,downloadResult::checksumMismatch ) ;
+			}
+		}
+
+		s.file.close() ;
+
+		QFile::remove( s.path ) ;
+
+		if( !s.file.rename( s.path ) ){
+
+			return this->report( s,downloadResult::fileError ) ;
+		}
+
+		QFile::remove( s.path + ".part.validator" ) ;
+
+		this->report( s,downloadResult::finished ) ;
+	}
+	QByteArray validatorsKey( QUrl e )
+	{
+		if( !m_validatorsIgnoredQueryItems.isEmpty() && e.hasQuery() ){
+
+			QUrlQuery q( e ) ;
+
+			for( const auto& it : m_validatorsIgnoredQueryItems ){
+
+				q.removeAllQueryItems( it ) ;
+			}
+
+			e.setQuery( q ) ;
+		}
+
+		return e.toEncoded() ;
+	}
+	QString validatorsPath( const QUrl& e )
+	{
+		auto s = QCryptographicHash::hash( this->validatorsKey( e ),QCryptographicHash::Sha1 ).toHex() ;
+
+		return m_cacheDirectory + "/" + QString::fromLatin1( s ) ;
+	}
+	validators_t& validators( const QUrl& e )
+	{
+		auto key = this->validatorsKey( e ) ;
+
+		auto it = m_validators.find( key ) ;
+
+		if( it != m_validators.end() ){
+
+			return it.value() ;
+		}
+
+		validators_t s ;
+
+		if( !m_cacheDirectory.isEmpty() ){
+
+			QFile f( this->validatorsPath( e ) ) ;
+
+			if( f.open( QIODevice::ReadOnly ) ){
+
+				s.first  = f.readLine().trimmed() ;
+				s.second = f.readLine().trimmed() ;
+			}
+		}
+
+		return m_validators.insert( key,s ).value() ;
+	}
+	void saveValidators( QNetworkReply& e )
+	{
+		if( m_cacheDirectory.isEmpty() ||
+		    e.operation() != QNetworkAccessManager::GetOperation ||
+		    e.attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() != 200 ){
+
+			return ;
+		}
+
+		validators_t s( e.rawHeader( "ETag" ),e.rawHeader( "Last-Modified" ) ) ;
+
+		auto url = e.request().url() ;
+
+		auto& m = this->validators( url ) ;
+
+		if( m == s ){
+
+			return ;
+		}
+
+		m = s ;
+
+		QFile f( this->validatorsPath( url ) ) ;
+
+		if( s.first.isEmpty() && s.second.isEmpty() ){
+
+			f.remove() ;
+
+		}else if( f.open( QIODevice::WriteOnly | QIODevice::Truncate ) ){
+
+			f.write( s.first + "\n" + s.second + "\n" ) ;
+		}
+	}
+	void readyRead( QNetworkReply * e )
+	{
+		auto it = m_entries.find( e ) ;
+
+		if( it == m_entries.end() || !it->second->data ){
+
+			return ;
+		}
+
+		auto s = it->second ;
+
+		/*
+		 * The body of a reply that will be retried is not the one the caller wants
+		 */
+		if( this->canRetry( *s,*e ) ){
+
+			return ;
+		}
+
+		/*
+		 * "data" may start or cancel requests and the entry is looked up again after it runs
+		 */
+		auto data = std::move( s->data ) ;
+
+		auto more = data( *e ) ;
+
+		it = m_entries.find( e ) ;
+
+		if( it == m_entries.end() || it->second != s ){
+
+			return ;
+		}
+
+		if( more ){
+
+			s->data = std::move( data ) ;
+		}else{
+			this->saveValidators( *e ) ;
+
+			auto functions = this->release( *s ) ;
+
+			m_entries.erase( it ) ;
+
+			this->done( s->host ) ;
+
+			for( auto& function : functions ){
+
+				function( *e ) ;
+			}
+
+			e->abort() ;
+			e->deleteLater() ;
+		}
+	}
+private slots:
+	void tick()
+	{
+		m_currentSlot = ( m_currentSlot + 1 ) % m_slotCount ;
+
+		std::vector< waiter * > expired ;
+
+		for( auto e : m_wheel[ m_currentSlot ] ){
+
+			if( e->rounds == 0 ){
+
+				expired.emplace_back( e ) ;
+			}else{
+				e->rounds-- ;
+			}
+		}
+
+		/*
+		 * Timed out callers are all taken off their requests before any timeout function runs
+		 * because the functions may start or cancel requests
+		 */
+		std::vector< std::function< void() > > timeOuts ;
+
+		for( auto e : expired ){
+
+			auto& s = *e->owner ;
+
+			this->unwait( *e ) ;
+
+			timeOuts.emplace_back( std::move( e->timeOut ) ) ;
+
+			s.waiters.remove_if( [ e ]( const waiter& m ){ return &m == e ; } ) ;
+
+			if( s.waiters.empty() ){
+
+				this->abandon( s ) ;
+			}
+		}
+
+		for( auto& it : timeOuts ){
+
+			it() ;
+		}
+	}
+	void networkReply( QNetworkReply * e )
+	{
+		auto it = m_entries.find( e ) ;
+
+		if( it == m_entries.end() ){
+
+			return ;
+		}
+
+		auto s = it->second ;
+
+		const auto& host = s->host ;
+
+		if( NetworkAccessManager::failed( *e ) ){
+
+			this->failure( host ) ;
+
+			if( this->retry( it,e ) ){
+
+				return ;
+			}
+		}else{
+			this->success( host ) ;
+		}
+
+		this->saveValidators( *e ) ;
+
+		auto data = std::move( s->data ) ;
+
+		/*
+		 * The entry is removed first because the functions may start or cancel
+		 * other requests
+		 */
+		auto functions = this->release( *s ) ;
+
+		m_entries.erase( it ) ;
+
+		this->done( s->host ) ;
+
+		if( data && e->bytesAvailable() > 0 ){
+
+			data( *e ) ;
+		}
+
+		if( functions.size() == 1 ){
+
+			functions.front()( *e ) ;
+
+		}else if( functions.size() > 1 ){
+
+			auto body = e->readAll() ;
+
+			for( auto& function : functions ){
+
+				auto m = new NetworkAccessManagerSharedReply( *e,body ) ;
+
+				function( *m ) ;
+
+				m->deleteLater() ;
+			}
+		}
+
+		if( s->deleteReply ){
+
+			e->deleteLater() ;
+		}
 	}
 };
 
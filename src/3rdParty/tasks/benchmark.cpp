@@ -0,0 +1,385 @@
+/*
+ * copyright: 2014-2018
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Measures the cost of the library.
+ *
+ * The first table runs empty tasks with each execution policy."await" runs tasks one after
+ * another and shows the time it takes for a task to be started,run and for its continuation to
+ * be delivered back to the calling thread."then" starts all tasks at once and shows the
+ * throughput when many tasks are in flight."allocations" is the number of heap allocations
+ * made by a single "Task::run().then()" round trip,including those made by Qt to deliver the
+ * continuation.
+ *
+ * The second table shows latency percentiles of tasks run one at a time:
+ *
+ * dispatch: from Task::run() to the task starting in a worker thread.
+ * hop:      from the task returning to its continuation starting in the calling thread.
+ * queue:    a future managing four tasks that run one after another.
+ * when_any: four tasks combined with Task::when_any().
+ * process:  spawning "/bin/echo" and capturing its output with Task::process::run().
+ *
+ * The third table shows the number of threads and the resident memory of the process after
+ * the tests of each policy ran.
+ *
+ * usage: tasks_benchmark [number of tasks]
+ */
+
+#include "task.hpp"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+static std::atomic< long > _allocations( 0 ) ;
+
+void * operator new( std::size_t size )
+{
+	_allocations++ ;
+
+	auto e = std::malloc( size ? size : 1 ) ;
+
+	if( e ){
+
+		return e ;
+	}else{
+		throw std::bad_alloc() ;
+	}
+}
+
+void operator delete( void * e ) noexcept
+{
+	std::free( e ) ;
+}
+
+void operator delete( void * e,std::size_t ) noexcept
+{
+	std::free( e ) ;
+}
+
+using clock_type = std::chrono::steady_clock ;
+
+static double _nanoseconds( clock_type::time_point a,clock_type::time_point b )
+{
+	return static_cast< double >( std::chrono::duration_cast< std::chrono::nanoseconds >( b - a ).count() ) ;
+}
+
+class samples
+{
+public:
+	samples( int count )
+	{
+		m_values.reserve( static_cast< std::size_t >( count ) ) ;
+	}
+	void add( double e )
+	{
+		m_values.emplace_back( e ) ;
+	}
+	void print( const char * name,const char * policy )
+	{
+		std::sort( m_values.begin(),m_values.end() ) ;
+
+		std::printf( "%-10s %-16s %10.1f %10.1f %10.1f %10.1f\n",
+			     name,
+			     policy,
+			     this->percentile( 50 ),
+			     this->percentile( 90 ),
+			     this->percentile( 99 ),
+			     this->percentile( 100 ) ) ;
+	}
+private:
+	/*
+	 * microseconds
+	 */
+	double percentile( int e )
+	{
+		if( m_values.empty() ){
+
+			return 0 ;
+		}
+
+		auto index = ( m_values.size() - 1 ) * static_cast< std::size_t >( e ) / 100 ;
+
+		return m_values[ index ] / 1000 ;
+	}
+	std::vector< double > m_values ;
+};
+
+static double _await( int count )
+{
+	QElapsedTimer timer ;
+
+	timer.start() ;
+
+	for( int i = 0 ; i < count ; i++ ){
+
+		Task::await( [](){} ) ;
+	}
+
+	return static_cast< double >( timer.nsecsElapsed() ) / count ;
+}
+
+static double _then( int count )
+{
+	QElapsedTimer timer ;
+	QEventLoop loop ;
+
+	int done = 0 ;
+
+	timer.start() ;
+
+	for( int i = 0 ; i < count ; i++ ){
+
+		Task::run( [](){} ).then( [ & ](){
+
+			if( ++done == count ){
+
+				loop.exit() ;
+			}
+		} ) ;
+	}
+
+	loop.exec() ;
+
+	return static_cast< double >( timer.nsecsElapsed() ) / count ;
+}
+
+static void _dispatch_and_hop( const char * policy,int count )
+{
+	samples dispatch( count ) ;
+	samples hop( count ) ;
+
+	QEventLoop loop ;
+
+	for( int i = 0 ; i < count ; i++ ){
+
+		clock_type::time_point started ;
+		clock_type::time_point finished ;
+
+		auto queued = clock_type::now() ;
+
+		Task::run( [ & ](){
+
+			started = clock_type::now() ;
+			finished = clock_type::now() ;
+
+		} ).then( [ & ](){
+
+			auto now = clock_type::now() ;
+
+			dispatch.add( _nanoseconds( queued,started ) ) ;
+			hop.add( _nanoseconds( finished,now ) ) ;
+
+			loop.exit() ;
+		} ) ;
+
+		loop.exec() ;
+	}
+
+	dispatch.print( "dispatch",policy ) ;
+	hop.print( "hop",policy ) ;
+}
+
+static void _queue( const char * policy,int count )
+{
+	samples s( count ) ;
+
+	QEventLoop loop ;
+
+	for( int i = 0 ; i < count ; i++ ){
+
+		auto start = clock_type::now() ;
+
+		Task::run( [](){},[](){},[](){},[](){} ).queue( [ & ](){
+
+			s.add( _nanoseconds( start,clock_type::now() ) ) ;
+
+			loop.exit() ;
+		} ) ;
+
+		loop.exec() ;
+	}
+
+	s.print( "queue",policy ) ;
+}
+
+static void _when_any( const char * policy,int count )
+{
+	samples s( count ) ;
+
+	auto fn = [](){ return 0 ; } ;
+
+	for( int i = 0 ; i < count ; i++ ){
+
+		auto start = clock_type::now() ;
+
+		Task::when_any( Task::run( fn ),Task::run( fn ),Task::run( fn ),Task::run( fn ) ).await() ;
+
+		s.add( _nanoseconds( start,clock_type::now() ) ) ;
+	}
+
+	s.print( "when_any",policy ) ;
+}
+
+static void _process( const char * policy,int count )
+{
+	samples s( count ) ;
+
+	for( int i = 0 ; i < count ; i++ ){
+
+		auto start = clock_type::now() ;
+
+		auto e = Task::process::run( "/bin/echo",QStringList{ "qt-update-notifier" } ).await() ;
+
+		if( e.std_out().isEmpty() ){
+
+			std::printf( "failed to capture output of /bin/echo\n" ) ;
+		}
+
+		s.add( _nanoseconds( start,clock_type::now() ) ) ;
+	}
+
+	s.print( "process",policy ) ;
+}
+
+/*
+ * Returns a field of /proc/self/status,ie "Threads" or "VmRSS".
+ */
+static QByteArray _status( const char * name )
+{
+	QFile f( "/proc/self/status" ) ;
+
+	if( f.open( QIODevice::ReadOnly ) ){
+
+		auto s = QByteArray( name ) + ":" ;
+
+		for( const auto& it : f.readAll().split( '\n' ) ){
+
+			if( it.startsWith( s ) ){
+
+				return it.mid( s.size() ).simplified() ;
+			}
+		}
+	}
+
+	return "-" ;
+}
+
+struct policy
+{
+	const char * name ;
+	Task::execution_policy value ;
+	QByteArray threads ;
+	QByteArray rss ;
+	QByteArray peak ;
+};
+
+int main( int argc,char * argv[] )
+{
+	QCoreApplication app( argc,argv ) ;
+
+	int count = argc > 1 ? std::atoi( argv[ 1 ] ) : 10000 ;
+
+	if( count < 1 ){
+
+		count = 10000 ;
+	}
+
+	/*
+	 * Spawning a process costs about a millisecond,keep the run short.
+	 */
+	int processes = std::max( count / 100,20 ) ;
+
+	std::vector< policy > policies{ { "thread_per_task",Task::execution_policy::thread_per_task,{},{},{} },
+					{ "thread_pool",Task::execution_policy::thread_pool,{},{},{} } } ;
+
+	std::printf( "%d tasks,nanoseconds and allocations per task\n\n",count ) ;
+	std::printf( "%-16s %12s %12s %12s\n","policy","await","then","allocations" ) ;
+
+	for( auto& it : policies ){
+
+		Task::set_execution_policy( it.value ) ;
+
+		/*
+		 * warm up,the first task run with the pool policy creates the pool
+		 */
+		_await( 10 ) ;
+
+		auto a = _await( count ) ;
+
+		auto allocations = _allocations.load() ;
+
+		auto b = _then( count ) ;
+
+		auto c = static_cast< double >( _allocations.load() - allocations ) / count ;
+
+		std::printf( "%-16s %12.0f %12.0f %12.1f\n",it.name,a,b,c ) ;
+	}
+
+	std::printf( "\nlatency in microseconds,%d processes\n\n",processes ) ;
+	std::printf( "%-10s %-16s %10s %10s %10s %10s\n","test","policy","p50","p90","p99","max" ) ;
+
+	for( auto& it : policies ){
+
+		Task::set_execution_policy( it.value ) ;
+
+		_dispatch_and_hop( it.name,count ) ;
+		_queue( it.name,count ) ;
+		_when_any( it.name,count ) ;
+		_process( it.name,processes ) ;
+
+		it.threads = _status( "Threads" ) ;
+		it.rss     = _status( "VmRSS" ) ;
+		it.peak    = _status( "VmHWM" ) ;
+	}
+
+	std::printf( "\nresources after the tests of each policy\n\n" ) ;
+	std::printf( "%-16s %10s %14s %14s\n","policy","threads","rss","peak rss" ) ;
+
+	for( const auto& it : policies ){
+
+		std::printf( "%-16s %10s %14s %14s\n",
+			     it.name,
+			     it.threads.constData(),
+			     it.rss.constData(),
+			     it.peak.constData() ) ;
+	}
+
+	return 0 ;
+}
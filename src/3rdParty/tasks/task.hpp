@@ -33,14 +33,38 @@
 
 #include <type_traits>
 #include <vector>
+#include <tuple>
 #include <utility>
 #include <future>
 #include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <new>
 #include <QThread>
+#include <QCoreApplication>
 #include <QEventLoop>
 #include <QMutex>
 #include <QProcess>
 #include <QVariant>
+#include <QTimer>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined( __cpp_impl_coroutine ) && defined( __has_include )
+#if __has_include( <coroutine> )
+#include <coroutine>
+#define TASK_HAS_COROUTINES 1
+#endif
+#endif
 
 /*
  *
@@ -82,9 +106,12 @@
  *              managing only one task.
  *
  * 5. .cancel(). This method can be used to cancel a future. It is important to know
- *               that this method does not terminate a running thread that is powering a future, it just
- *               releases memory used by a future and this method should be used if a future is to be discarded
- *               after it it is acquired but never used.
+ *               that this method does not terminate a running thread that is powering a future.
+ *               If the future was never started,its memory is released and the future must not be used again.
+ *               If the future is running,its cancellation token is cancelled and its continuation
+ *               will still be called when the wrapped function returns. Wrapped functions created with
+ *               Task::run( token,function ) and Task::process::run() stop early when their token is cancelled.
+ *               Cancelling a future that manages other futures cancels all of them.
  *
  * 6. .all_threads(). This method returns a vector of QThreads that are powering futures.
  *                    The vector will contain a single entry if this future powers its own task. If this future
@@ -98,6 +125,22 @@
  * 8. .manages_multiple_futures(). This method can be used to check if a future powers
  *    its own task or manages other futures.
  *
+ * Task::when_all() and Task::when_any() combine futures into a future whose result is a tuple or a vector
+ * with results of all of them or a pair with the result of the first one to finish and its position.
+ * .get() on a future made by Task::when_any() runs only the first future,in the current thread.
+ *
+ * 9. co_await. When built with a compiler that supports C++20 coroutines,TASK_HAS_COROUTINES
+ *              is defined and a future can be awaited with "co_await" in a coroutine that returns
+ *              Task::coroutine. The coroutine is suspended while the wrapped function runs in the
+ *              background and resumed in the current thread when it finish running. Unlike .await(),
+ *              no event loop is started and control returns to the caller at the suspension point.
+ *
+ * Tasks run on a shared pool of worker threads by default.Each worker has its own queue
+ * of tasks and an idle worker takes tasks from the queues of busy ones. Call
+ * Task::set_execution_policy( Task::execution_policy::thread_per_task ) to go back to
+ * running each task in a QThread of its own. Futures powered by the pool do not own a
+ * QThread and the vector returned by .all_threads() will contain nullptr for them.
+ *
  *
  * The future is of type "Task::future<T>&" and "std::reference_wrapper"[1]
  * class can be used if they are to be managed in a container that can not handle references.
@@ -110,12 +153,334 @@ namespace Task
 	template< typename T >
 	class future;
 
+	enum class execution_policy{ thread_pool,thread_per_task } ;
+
+	/*
+	 * Quality of service of a task.Each class has its own set of worker threads so that tasks
+	 * of one class never wait behind tasks of another.
+	 *
+	 * interactive: short tasks the user is waiting on.
+	 * normal:      everything else,the default for tasks created outside of a task.
+	 * background:  maintenance work nobody is waiting on,ie periodic checks.
+	 *
+	 * A task created inside another task gets the class of the task it was created in.
+	 */
+	enum class qos{ interactive,normal,background } ;
+
+	/*
+	 * A cancellation token is shared between a future and the function it runs.The function
+	 * is expected to check "cancelled()" from time to time and return early when it is true.
+	 * A token becomes cancelled when "cancel()" is called on it or on its future or when its
+	 * deadline passes.Copies of a token share the same state.
+	 */
+	class cancellation_token
+	{
+	public:
+		using clock = std::chrono::steady_clock ;
+
+		cancellation_token() : m_state( std::make_shared< state >() )
+		{
+		}
+		explicit cancellation_token( clock::time_point deadline ) :
+			m_state( std::make_shared< state >( deadline ) )
+		{
+		}
+		explicit cancellation_token( std::chrono::milliseconds timeout ) :
+			cancellation_token( clock::now() + timeout )
+		{
+		}
+		/*
+		 * An empty token,it is never cancelled and costs no allocation.Futures that were
+		 * not given a token have one of these.
+		 */
+		cancellation_token( std::nullptr_t )
+		{
+		}
+		void cancel() const
+		{
+			if( m_state ){
+
+				m_state->cancelled = true ;
+			}
+		}
+		bool cancelled() const
+		{
+			if( m_state ){
+
+				return m_state->cancelled || ( m_state->has_deadline && clock::now() >= m_state->deadline ) ;
+			}else{
+				return false ;
+			}
+		}
+		bool has_deadline() const
+		{
+			return m_state && m_state->has_deadline ;
+		}
+		clock::time_point deadline() const
+		{
+			return m_state ? m_state->deadline : clock::time_point::max() ;
+		}
+	private:
+		struct state
+		{
+			state()
+			{
+			}
+			state( clock::time_point e ) : has_deadline( true ),deadline( e )
+			{
+			}
+			std::atomic< bool > cancelled{ false } ;
+			bool has_deadline = false ;
+			clock::time_point deadline ;
+		};
+		std::shared_ptr< state > m_state ;
+	};
+
 	namespace detail
 	{
 		template< typename T >
 		void add_void( Task::future< T >&,Task::future< T >&,std::function< T() >&& ) ;
 		template< typename T >
 		void add( Task::future< T >&,Task::future< T >&,std::function< void( T ) >&& ) ;
+
+		/*
+		 * A move only replacement for std::function that stores small callables,ie lambdas
+		 * that capture a few pointers or a std::function,inside the object instead of on the heap.
+		 */
+		template< typename Signature >
+		class move_only_function ;
+
+		template< typename R,typename ... Args >
+		class move_only_function< R( Args ... ) >
+		{
+			static const std::size_t buffer_size = 6 * sizeof( void * ) ;
+
+			template< typename F >
+			using stored_inline = std::integral_constant< bool,sizeof( F ) <= buffer_size &&
+									   alignof( F ) <= alignof( std::max_align_t ) &&
+									   std::is_nothrow_move_constructible< F >::value > ;
+
+			template< typename F,typename E = decltype( std::declval< F& >()( std::declval< Args >() ... ) ) >
+			static std::integral_constant< bool,std::is_void< R >::value || std::is_convertible< E,R >::value > callable( int ) ;
+
+			template< typename F >
+			static std::false_type callable( ... ) ;
+		public:
+			move_only_function()
+			{
+			}
+			move_only_function( std::nullptr_t )
+			{
+			}
+			template< typename F,
+				  typename = typename std::enable_if< decltype( callable< F >( 0 ) )::value >::type >
+			move_only_function( F function )
+			{
+				this->assign( std::move( function ),stored_inline< F >() ) ;
+			}
+			move_only_function( move_only_function&& other ) noexcept
+			{
+				this->take( other ) ;
+			}
+			move_only_function& operator=( move_only_function&& other ) noexcept
+			{
+				if( this != &other ){
+
+					this->reset() ;
+					this->take( other ) ;
+				}
+
+				return *this ;
+			}
+			move_only_function& operator=( std::nullptr_t ) noexcept
+			{
+				this->reset() ;
+				return *this ;
+			}
+			move_only_function( const move_only_function& ) = delete ;
+			move_only_function& operator=( const move_only_function& ) = delete ;
+			~move_only_function()
+			{
+				this->reset() ;
+			}
+			explicit operator bool() const noexcept
+			{
+				return m_operations != nullptr ;
+			}
+			R operator()( Args ... args )
+			{
+				return m_operations->invoke( m_buffer,std::forward< Args >( args ) ... ) ;
+			}
+			friend bool operator==( const move_only_function& e,std::nullptr_t ) noexcept
+			{
+				return !e ;
+			}
+			friend bool operator!=( const move_only_function& e,std::nullptr_t ) noexcept
+			{
+				return static_cast< bool >( e ) ;
+			}
+		private:
+			struct operations
+			{
+				R ( *invoke )( void *,Args&& ... ) ;
+				void ( *move )( void *,void * ) ;
+				void ( *destroy )( void * ) ;
+			};
+			template< typename F >
+			struct local
+			{
+				static R invoke( void * e,Args&& ... args )
+				{
+					return static_cast< R >( ( *static_cast< F * >( e ) )( std::forward< Args >( args ) ... ) ) ;
+				}
+				static void move( void * from,void * to )
+				{
+					new ( to ) F( std::move( *static_cast< F * >( from ) ) ) ;
+					static_cast< F * >( from )->~F() ;
+				}
+				static void destroy( void * e )
+				{
+					static_cast< F * >( e )->~F() ;
+				}
+				static const operations * get()
+				{
+					static const operations e{ &local::invoke,&local::move,&local::destroy } ;
+					return &e ;
+				}
+			};
+			template< typename F >
+			struct remote
+			{
+				static R invoke( void * e,Args&& ... args )
+				{
+					return static_cast< R >( ( **static_cast< F ** >( e ) )( std::forward< Args >( args ) ... ) ) ;
+				}
+				static void move( void * from,void * to )
+				{
+					*static_cast< F ** >( to ) = *static_cast< F ** >( from ) ;
+				}
+				static void destroy( void * e )
+				{
+					delete *static_cast< F ** >( e ) ;
+				}
+				static const operations * get()
+				{
+					static const operations e{ &remote::invoke,&remote::move,&remote::destroy } ;
+					return &e ;
+				}
+			};
+			template< typename F >
+			void assign( F&& function,std::true_type )
+			{
+				using type = typename std::decay< F >::type ;
+				new ( m_buffer ) type( std::forward< F >( function ) ) ;
+				m_operations = local< type >::get() ;
+			}
+			template< typename F >
+			void assign( F&& function,std::false_type )
+			{
+				using type = typename std::decay< F >::type ;
+				*reinterpret_cast< type ** >( m_buffer ) = new type( std::forward< F >( function ) ) ;
+				m_operations = remote< type >::get() ;
+			}
+			void take( move_only_function& other ) noexcept
+			{
+				if( other.m_operations ){
+
+					other.m_operations->move( other.m_buffer,m_buffer ) ;
+					m_operations = other.m_operations ;
+					other.m_operations = nullptr ;
+				}
+			}
+			void reset() noexcept
+			{
+				if( m_operations ){
+
+					m_operations->destroy( m_buffer ) ;
+					m_operations = nullptr ;
+				}
+			}
+			const operations * m_operations = nullptr ;
+			alignas( std::max_align_t ) unsigned char m_buffer[ buffer_size ] ;
+		};
+
+		/*
+		 * Objects of classes that derive from this class are allocated from a per class list
+		 * of blocks released by objects that were deleted before them,saving a trip to the heap
+		 * for objects that are created and destroyed frequently.
+		 */
+		template< typename T >
+		class recyclable
+		{
+		public:
+			static void * operator new( std::size_t size )
+			{
+				if( size == sizeof( T ) ){
+
+					auto e = recyclable::blocks().pop() ;
+
+					if( e ){
+
+						return e ;
+					}
+				}
+
+				return ::operator new( size ) ;
+			}
+			static void operator delete( void * e,std::size_t size )
+			{
+				if( size != sizeof( T ) || !recyclable::blocks().push( e ) ){
+
+					::operator delete( e ) ;
+				}
+			}
+		private:
+			class free_list
+			{
+			public:
+				free_list()
+				{
+					m_blocks.reserve( m_max_size ) ;
+				}
+				void * pop()
+				{
+					std::lock_guard< std::mutex > m( m_mutex ) ;
+
+					if( m_blocks.empty() ){
+
+						return nullptr ;
+					}else{
+						auto e = m_blocks.back() ;
+						m_blocks.pop_back() ;
+						return e ;
+					}
+				}
+				bool push( void * e )
+				{
+					std::lock_guard< std::mutex > m( m_mutex ) ;
+
+					if( m_blocks.size() < m_max_size ){
+
+						m_blocks.push_back( e ) ;
+						return true ;
+					}else{
+						return false ;
+					}
+				}
+			private:
+				const std::size_t m_max_size = 64 ;
+				std::mutex m_mutex ;
+				std::vector< void * > m_blocks ;
+			};
+			static free_list& blocks()
+			{
+				/*
+				 * Never deleted because objects may be released after static objects are destroyed.
+				 */
+				static free_list * e = new free_list() ;
+				return *e ;
+			}
+		};
 	}
 
 	template< typename T >
@@ -150,13 +515,13 @@ namespace Task
 	}	
 
 	template< typename T >
-	class future : private QObject
+	class future : private QObject,public Task::detail::recyclable< future< T > >
 	{
 	public:
 		/*
 		 * Use this API if you care about the result
 		 */
-		void then( std::function< void( T ) > function )
+		void then( Task::detail::move_only_function< void( T ) > function )
 		{
 			m_function = std::move( function ) ;
 			this->start() ;
@@ -164,12 +529,12 @@ namespace Task
 		/*
 		 * Use this API if you DO NOT care about the result
 		 */
-		void then( std::function< void() > function )
+		void then( Task::detail::move_only_function< void() > function )
 		{
 			m_function_1 = std::move( function ) ;
 			this->start() ;
 		}
-		void queue( std::function< void() > function = [](){} )
+		void queue( Task::detail::move_only_function< void() > function = [](){} )
 		{
 			if( this->manages_multiple_futures() ){
 
@@ -183,15 +548,15 @@ namespace Task
 		/*
 		 * Below two API just exposes existing functionality using more standard names
 		 */
-		void when_all( std::function< void() > function = [](){} )
+		void when_all( Task::detail::move_only_function< void() > function = [](){} )
 		{
 			this->then( std::move( function ) ) ;
 		}
-		void when_seq( std::function< void() > function = [](){} )
+		void when_seq( Task::detail::move_only_function< void() > function = [](){} )
 		{
 			this->queue( std::move( function ) ) ;
 		}
-		void when_any( std::function< void() > function = [](){} )
+		void when_any( Task::detail::move_only_function< void() > function = [](){} )
 		{
 			if( this->manages_multiple_futures() ){
 
@@ -230,6 +595,36 @@ namespace Task
 
 			return q ;
 		}
+#if TASK_HAS_COROUTINES
+		auto operator co_await()
+		{
+			class awaiter{
+			public:
+				awaiter( future< T >& e ) : m_future( e )
+				{
+				}
+				bool await_ready() const noexcept
+				{
+					return false ;
+				}
+				void await_suspend( std::coroutine_handle<> h )
+				{
+					m_future.m_function = [ this,h ]( T&& r ){ m_result = std::move( r ) ; h.resume() ; } ;
+
+					m_future.start() ;
+				}
+				T await_resume()
+				{
+					return std::move( m_result ) ;
+				}
+			private:
+				future< T >& m_future ;
+				T m_result ;
+			};
+
+			return awaiter( *this ) ;
+		}
+#endif
 		bool manages_multiple_futures()
 		{
 			return m_tasks.size() > 0 ;
@@ -248,6 +643,8 @@ namespace Task
 		}
 		void start()
 		{
+			m_started = true ;
+
 			if( this->manages_multiple_futures() ){
 
 				this->_start() ;
@@ -257,6 +654,8 @@ namespace Task
 		}
 		void cancel()
 		{
+			m_token.cancel() ;
+
 			if( this->manages_multiple_futures() ){
 
 				for( auto& it : m_tasks ){
@@ -264,11 +663,23 @@ namespace Task
 					it.first->cancel() ;
 				}
 
-				this->deleteLater() ;
+				if( !m_started ){
+
+					this->deleteLater() ;
+				}
+
 			}else{
 				m_cancel() ;
 			}
 		}
+		const Task::cancellation_token& token() const
+		{
+			return m_token ;
+		}
+		bool started() const
+		{
+			return m_started ;
+		}
 		future() = default ;
 		future( const future& ) = delete ;
 		future( future&& ) = delete ;
@@ -276,24 +687,20 @@ namespace Task
 		future& operator=( future&& ) = delete ;
 
 		future( QThread * e,
-			std::function< void() >&& start,
-			std::function< void() >&& cancel,
-			std::function< T() >&& get ) :
+			Task::detail::move_only_function< void() >&& start,
+			Task::detail::move_only_function< void() >&& cancel,
+			Task::detail::move_only_function< T() >&& get,
+			Task::cancellation_token token = nullptr ) :
 			m_thread( e ),
 			m_start ( std::move( start ) ),
 			m_cancel( std::move( cancel ) ),
-			m_get   ( std::move( get ) )
+			m_get   ( std::move( get ) ),
+			m_token ( std::move( token ) )
 		{
-			if( m_thread ){
-
-				m_threads.push_back( m_thread ) ;
-			}else{
-				/*
-				 * This object was created by "_private_future< T >()" class.
-				 * It has no QThread of its own because it only manages other futures.
-				 *
-				 */
-			}
+			/*
+			 * "e" is nullptr when the future is powered by the thread pool.
+			 */
+			m_threads.push_back( m_thread ) ;
 		}
 		void run( T&& r )
 		{
@@ -312,7 +719,7 @@ namespace Task
 					  Task::future< E >&,
 					  std::function< void( E ) >&& ) ;
 	private:
-		void _when_any( std::function< void() > function = [](){} )
+		void _when_any( Task::detail::move_only_function< void() > function )
 		{
 			m_when_any_function = std::move( function ) ;
 
@@ -320,25 +727,16 @@ namespace Task
 
 				it.first->then( [ & ]( T&& e ){
 
-					QMutexLocker m( &m_mutex ) ;
-
-					m_counter++ ;
+					auto counter = ++m_counter ;
 
-					if( m_task_not_run ){
-
-						m_task_not_run = false ;
-
-						m.unlock() ;
+					it.second( std::forward<T>( e ) ) ;
 
-						it.second( std::forward<T>( e ) ) ;
+					if( m_task_not_run.exchange( false ) ){
 
 						m_when_any_function() ;
-					}else{
-						m.unlock() ;
-						it.second( std::forward<T>( e ) ) ;
 					}
 
-					if( m_counter == m_tasks.size() ){
+					if( counter == m_tasks.size() ){
 
 						this->deleteLater() ;
 					}
@@ -369,15 +767,9 @@ namespace Task
 
 				it.first->then( [ & ]( T&& e ){
 
-					QMutexLocker m( &m_mutex ) ;
-
-					Q_UNUSED( m ) ;
-
-					m_counter++ ;
-
 					it.second( std::forward<T>( e ) ) ;
 
-					if( m_counter == m_tasks.size() ){
+					if( ++m_counter == m_tasks.size() ){
 
 						if( m_function_1 != nullptr ){
 
@@ -395,30 +787,31 @@ namespace Task
 		}
 
 		QThread * m_thread = nullptr ;
-		std::function< void( T ) > m_function = nullptr ;
-		std::function< void() > m_function_1  = nullptr ;
-		std::function< void() > m_start       = [](){} ;
-		std::function< void() > m_cancel      = [](){} ;
-		std::function< T() > m_get            = [](){ return T() ; } ;
-		std::function< void() > m_when_any_function ;
-
-		QMutex m_mutex ;
+		Task::detail::move_only_function< void( T ) > m_function = nullptr ;
+		Task::detail::move_only_function< void() > m_function_1  = nullptr ;
+		Task::detail::move_only_function< void() > m_start       = [](){} ;
+		Task::detail::move_only_function< void() > m_cancel      = [](){} ;
+		Task::detail::move_only_function< T() > m_get            = [](){ return T() ; } ;
+		Task::detail::move_only_function< void() > m_when_any_function ;
+
 		std::vector< std::pair< Task::future< T > *,std::function< void( T ) > > > m_tasks ;
 		std::vector< QThread * > m_threads ;
-		decltype( m_tasks.size() ) m_counter = 0 ;
-		bool m_task_not_run = true ;
+		std::atomic< std::size_t > m_counter{ 0 } ;
+		std::atomic< bool > m_task_not_run{ true } ;
+		bool m_started = false ;
+		Task::cancellation_token m_token = nullptr ;
 	};
 
 	template<>
-	class future< void > : private QObject
+	class future< void > : private QObject,public Task::detail::recyclable< future< void > >
 	{
 	public:
-		void then( std::function< void() > function )
+		void then( Task::detail::move_only_function< void() > function )
 		{
 			m_function = std::move( function ) ;
 			this->start() ;
 		}
-		void queue( std::function< void() > function = [](){} )
+		void queue( Task::detail::move_only_function< void() > function = [](){} )
 		{
 			if( this->manages_multiple_futures() ){
 
@@ -429,7 +822,7 @@ namespace Task
 				this->then( std::move( function ) ) ;
 			}
 		}
-		void when_any( std::function< void() > function = [](){} )
+		void when_any( Task::detail::move_only_function< void() > function = [](){} )
 		{
 			if( this->manages_multiple_futures() ){
 
@@ -441,11 +834,11 @@ namespace Task
 		/*
 		 * Below two API just exposes existing functionality using more standard names
 		 */
-		void when_all( std::function< void() > function = [](){} )
+		void when_all( Task::detail::move_only_function< void() > function = [](){} )
 		{
 			this->then( std::move( function ) ) ;
 		}
-		void when_seq( std::function< void() > function = [](){} )
+		void when_seq( Task::detail::move_only_function< void() > function = [](){} )
 		{
 			this->queue( std::move( function ) ) ;
 		}
@@ -474,6 +867,34 @@ namespace Task
 
 			p.exec() ;
 		}
+#if TASK_HAS_COROUTINES
+		auto operator co_await()
+		{
+			class awaiter{
+			public:
+				awaiter( future< void >& e ) : m_future( e )
+				{
+				}
+				bool await_ready() const noexcept
+				{
+					return false ;
+				}
+				void await_suspend( std::coroutine_handle<> h )
+				{
+					m_future.m_function = [ h ](){ h.resume() ; } ;
+
+					m_future.start() ;
+				}
+				void await_resume()
+				{
+				}
+			private:
+				future< void >& m_future ;
+			};
+
+			return awaiter( *this ) ;
+		}
+#endif
 		bool manages_multiple_futures()
 		{
 			return m_tasks.size() > 0 ;
@@ -492,6 +913,8 @@ namespace Task
 		}
 		void start()
 		{
+			m_started = true ;
+
 			if( this->manages_multiple_futures() ){
 
 				this->_start() ;
@@ -501,6 +924,8 @@ namespace Task
 		}
 		void cancel()
 		{
+			m_token.cancel() ;
+
 			if( this->manages_multiple_futures() ){
 
 				for( auto& it : m_tasks ){
@@ -508,11 +933,23 @@ namespace Task
 					it.first->cancel() ;
 				}
 
-				this->deleteLater() ;
+				if( !m_started ){
+
+					this->deleteLater() ;
+				}
+
 			}else{
 				m_cancel() ;
 			}
 		}
+		const Task::cancellation_token& token() const
+		{
+			return m_token ;
+		}
+		bool started() const
+		{
+			return m_started ;
+		}
 		future() = default ;
 		future( const future& ) = delete ;
 		future( future&& ) = delete ;
@@ -520,24 +957,20 @@ namespace Task
 		future& operator=( future&& ) = delete ;
 
 		future(	QThread * e ,
-			std::function< void() >&& start,
-			std::function< void() >&& cancel,
-			std::function< void() >&& get ) :
+			Task::detail::move_only_function< void() >&& start,
+			Task::detail::move_only_function< void() >&& cancel,
+			Task::detail::move_only_function< void() >&& get,
+			Task::cancellation_token token = nullptr ) :
 			m_thread( e ),
 			m_start ( std::move( start ) ),
 			m_cancel( std::move( cancel ) ),
-			m_get   ( std::move( get ) )
+			m_get   ( std::move( get ) ),
+			m_token ( std::move( token ) )
 		{
-			if( m_thread ){
-
-				m_threads.push_back( m_thread ) ;
-			}else{
-				/*
-				 * This object was created by "_private_future< T >()" class.
-				 * It has no QThread of its own because it only manages other futures.
-				 *
-				 */
-			}
+			/*
+			 * "e" is nullptr when the future is powered by the thread pool.
+			 */
+			m_threads.push_back( m_thread ) ;
 		}
 
 		template< typename T >
@@ -549,7 +982,7 @@ namespace Task
 			m_function() ;
 		}
 	private:
-		void _when_any( std::function< void() > function )
+		void _when_any( Task::detail::move_only_function< void() > function )
 		{
 			m_when_any_function = std::move( function ) ;
 
@@ -557,25 +990,16 @@ namespace Task
 
 				it.first->then( [ & ](){
 
-					QMutexLocker m( &m_mutex ) ;
+					auto counter = ++m_counter ;
 
-					m_counter++ ;
-
-					if( m_task_not_run ){
-
-						m_task_not_run = false ;
-
-						m.unlock() ;
+					it.second() ;
 
-						it.second() ;
+					if( m_task_not_run.exchange( false ) ){
 
 						m_when_any_function() ;
-					}else{
-						m.unlock() ;
-						it.second() ;
 					}
 
-					if( m_counter == m_tasks.size() ){
+					if( counter == m_tasks.size() ){
 
 						this->deleteLater() ;
 					}
@@ -607,15 +1031,9 @@ namespace Task
 
 				it.first->then( [ & ](){
 
-					QMutexLocker m( &m_mutex ) ;
-
-					Q_UNUSED( m ) ;
-
-					m_counter++ ;
-
 					it.second() ;
 
-					if( m_counter == m_tasks.size() ){
+					if( ++m_counter == m_tasks.size() ){
 
 						m_function() ;
 
@@ -627,16 +1045,17 @@ namespace Task
 
 		QThread * m_thread = nullptr ;
 
-		std::function< void() > m_function = [](){} ;
-		std::function< void() > m_start    = [](){} ;
-		std::function< void() > m_cancel   = [](){} ;
-		std::function< void() > m_get      = [](){} ;
-		std::function< void() > m_when_any_function ;
-		QMutex m_mutex ;
+		Task::detail::move_only_function< void() > m_function = [](){} ;
+		Task::detail::move_only_function< void() > m_start    = [](){} ;
+		Task::detail::move_only_function< void() > m_cancel   = [](){} ;
+		Task::detail::move_only_function< void() > m_get      = [](){} ;
+		Task::detail::move_only_function< void() > m_when_any_function ;
 		std::vector< std::pair< Task::future< void > *,std::function< void() > > > m_tasks ;
 		std::vector< QThread * > m_threads ;
-		decltype( m_tasks.size() ) m_counter = 0 ;
-		bool m_task_not_run = true ;
+		std::atomic< std::size_t > m_counter{ 0 } ;
+		std::atomic< bool > m_task_not_run{ true } ;
+		bool m_started = false ;
+		Task::cancellation_token m_token = nullptr ;
 	};
 
 	namespace detail
@@ -644,51 +1063,384 @@ namespace Task
 		/*
 		 * -------------------------Start of internal helper functions-------------------------
 		 */
-		template< typename T >
-		class ThreadHelper : public QThread
+
+		/*
+		 * A fixed number of worker threads,each with its own queue.A worker takes new work
+		 * from the back of its own queue and when it has nothing to do,it takes work from the
+		 * front of the queue of another worker.Work submitted from outside of the pool is
+		 * spread across the queues in a round robin fashion.
+		 */
+		inline Task::qos& current_qos()
 		{
-		public:
-			ThreadHelper( std::function< T() >&& function ) :
-				m_function( std::move( function ) ),
-				m_future( this,
-					  [ this ](){ this->start() ; },
-					  [ this ](){ this->deleteLater() ; },
-					  [ this ](){ this->deleteLater() ; return m_function() ; } )
-			{
-				connect( this,&QThread::finished,this,&QThread::deleteLater ) ;
-			}
-			future<T>& Future()
-			{
-				return m_future ;
-			}
-		private:
-			~ThreadHelper()
-			{
-				m_future.run( std::move( m_result ) ) ;
+			static thread_local Task::qos e = Task::qos::normal ;
+			return e ;
+		}
+
+		inline QThread::Priority thread_priority( Task::qos e )
+		{
+			if( e == Task::qos::interactive ){
+
+				return QThread::HighPriority ;
+
+			}else if( e == Task::qos::background ){
+
+				return QThread::LowestPriority ;
+			}else{
+				return QThread::NormalPriority ;
 			}
-			void run()
-			{
-				m_result = m_function() ;
+		}
+
+		/*
+		 * Linux ignores the priority given to QThread::start() for threads of the default
+		 * scheduling policy,it takes a nice value to make the scheduler prefer other threads.
+		 * A thread has a nice value of its own and raising it needs no privileges,lowering
+		 * it does and so interactive threads keep the nice value of the process.
+		 */
+		inline void set_thread_nice( Task::qos e )
+		{
+#ifdef __linux__
+			if( e == Task::qos::background ){
+
+				setpriority( PRIO_PROCESS,static_cast< id_t >( syscall( SYS_gettid ) ),10 ) ;
 			}
-			std::function< T() > m_function ;
-			future<T> m_future ;
-			T m_result ;
-		};
+#else
+			( void )e ;
+#endif
+		}
 
-		template<>
-		class ThreadHelper< void > : public QThread
+		class thread_pool
 		{
 		public:
-			ThreadHelper( std::function< void() >&& function ) :
-				m_function( std::move( function ) ),
-				m_future( this,
-					  [ this ](){ this->start() ; },
-					  [ this ](){ this->deleteLater() ; },
-					  [ this ](){ m_function() ; this->deleteLater() ; } )
+			static thread_pool& instance( Task::qos e )
 			{
-				connect( this,&QThread::finished,this,&QThread::deleteLater ) ;
-			}
-			future< void >& Future()
+				/*
+				 * Intentionally never deleted,workers may still be running a task when
+				 * the application exits and they end with the process.
+				 */
+				if( e == Task::qos::interactive ){
+
+					static thread_pool * pool = new thread_pool( e,2 ) ;
+					return *pool ;
+
+				}else if( e == Task::qos::background ){
+
+					static thread_pool * pool = new thread_pool( e,QThread::idealThreadCount() / 2 ) ;
+					return *pool ;
+				}else{
+					static thread_pool * pool = new thread_pool( e,QThread::idealThreadCount() ) ;
+					return *pool ;
+				}
+			}
+			void submit( Task::detail::move_only_function< void() > function )
+			{
+				auto index = this->current_worker() ;
+
+				if( index < 0 ){
+
+					index = static_cast< int >( m_next++ % m_workers.size() ) ;
+				}
+
+				/*
+				 * The count goes up before the task is visible,a worker that takes the task
+				 * right away must never bring the count below zero.
+				 */
+				std::unique_lock< std::mutex > m( m_mutex ) ;
+
+				m_pending++ ;
+
+				m.unlock() ;
+
+				m_workers[ index ]->push( std::move( function ) ) ;
+
+				m_cv.notify_one() ;
+			}
+			std::size_t size() const
+			{
+				return m_workers.size() ;
+			}
+		private:
+			class worker : public QThread
+			{
+			public:
+				worker( thread_pool& pool,int index ) : m_pool( pool ),m_index( index )
+				{
+				}
+				void push( Task::detail::move_only_function< void() >&& function )
+				{
+					std::lock_guard< std::mutex > m( m_mutex ) ;
+					m_tasks.emplace_back( std::move( function ) ) ;
+				}
+				bool pop( Task::detail::move_only_function< void() >& function )
+				{
+					std::lock_guard< std::mutex > m( m_mutex ) ;
+
+					if( m_tasks.empty() ){
+
+						return false ;
+					}else{
+						function = std::move( m_tasks.back() ) ;
+						m_tasks.pop_back() ;
+						return true ;
+					}
+				}
+				bool steal( Task::detail::move_only_function< void() >& function )
+				{
+					std::lock_guard< std::mutex > m( m_mutex ) ;
+
+					if( m_tasks.empty() ){
+
+						return false ;
+					}else{
+						function = std::move( m_tasks.front() ) ;
+						m_tasks.pop_front() ;
+						return true ;
+					}
+				}
+			private:
+				void run()
+				{
+					thread_pool::worker_index() = m_index ;
+					thread_pool::current_pool() = &m_pool ;
+					Task::detail::current_qos() = m_pool.m_qos ;
+
+					Task::detail::set_thread_nice( m_pool.m_qos ) ;
+
+					m_pool.work( m_index ) ;
+				}
+				thread_pool& m_pool ;
+				int m_index ;
+				std::mutex m_mutex ;
+				std::deque< Task::detail::move_only_function< void() > > m_tasks ;
+			};
+
+			thread_pool( Task::qos e,int count ) : m_qos( e )
+			{
+				/*
+				 * Tasks frequently block on child processes and at least two workers
+				 * are needed for one of them to not hold up everything else.
+				 */
+				if( count < 2 ){
+
+					count = 2 ;
+				}
+
+				for( int i = 0 ; i < count ; i++ ){
+
+					m_workers.emplace_back( new worker( *this,i ) ) ;
+				}
+
+				for( auto& it : m_workers ){
+
+					it->start( Task::detail::thread_priority( e ) ) ;
+				}
+			}
+			static int& worker_index()
+			{
+				static thread_local int index = -1 ;
+				return index ;
+			}
+			static thread_pool *& current_pool()
+			{
+				static thread_local thread_pool * pool = nullptr ;
+				return pool ;
+			}
+			int current_worker()
+			{
+				if( thread_pool::current_pool() == this ){
+
+					return worker_index() ;
+				}else{
+					return -1 ;
+				}
+			}
+			bool next_task( int index,Task::detail::move_only_function< void() >& function )
+			{
+				if( m_workers[ index ]->pop( function ) ){
+
+					return true ;
+				}
+
+				auto size = static_cast< int >( m_workers.size() ) ;
+
+				for( int i = 1 ; i < size ; i++ ){
+
+					if( m_workers[ ( index + i ) % size ]->steal( function ) ){
+
+						return true ;
+					}
+				}
+
+				return false ;
+			}
+			void work( int index )
+			{
+				Task::detail::move_only_function< void() > function ;
+
+				while( true ){
+
+					if( this->next_task( index,function ) ){
+
+						m_pending-- ;
+
+						function() ;
+
+						function = nullptr ;
+
+						/*
+						 * Objects created by a task and deleted with deleteLater() belong
+						 * to this thread and the thread has no event loop to delete them.
+						 */
+						QCoreApplication::sendPostedEvents( nullptr,QEvent::DeferredDelete ) ;
+					}else{
+						std::unique_lock< std::mutex > m( m_mutex ) ;
+
+						m_cv.wait( m,[ this ](){ return m_pending > 0 ; } ) ;
+					}
+				}
+			}
+			Task::qos m_qos ;
+			std::vector< std::unique_ptr< worker > > m_workers ;
+			std::atomic< std::size_t > m_next{ 0 } ;
+			std::atomic< std::size_t > m_pending{ 0 } ;
+			std::mutex m_mutex ;
+			std::condition_variable m_cv ;
+		};
+
+		inline std::atomic< int >& policy()
+		{
+			static std::atomic< int > policy{ static_cast< int >( Task::execution_policy::thread_pool ) } ;
+			return policy ;
+		}
+
+		template< typename T >
+		class PoolHelper : public QObject,public Task::detail::recyclable< PoolHelper< T > >
+		{
+		public:
+			PoolHelper( Task::detail::move_only_function< T() >&& function,Task::cancellation_token token,Task::qos e ) :
+				m_function( std::move( function ) ),
+				m_qos( e ),
+				m_future( nullptr,
+					  [ this ](){ this->start() ; },
+					  [ this ](){ if( !m_future.started() ){ this->deleteLater() ; } },
+					  [ this ](){ this->deleteLater() ; return m_function() ; },
+					  std::move( token ) )
+			{
+			}
+			future<T>& Future()
+			{
+				return m_future ;
+			}
+		private:
+			~PoolHelper()
+			{
+				m_future.run( std::move( m_result ) ) ;
+			}
+			void start()
+			{
+				thread_pool::instance( m_qos ).submit( [ this ](){
+
+					m_result = m_function() ;
+
+					/*
+					 * This object lives in the thread that created it and that is
+					 * where the destructor and hence the continuation will run.
+					 */
+					this->deleteLater() ;
+				} ) ;
+			}
+			Task::detail::move_only_function< T() > m_function ;
+			Task::qos m_qos ;
+			future<T> m_future ;
+			T m_result ;
+		};
+
+		template<>
+		class PoolHelper< void > : public QObject,public Task::detail::recyclable< PoolHelper< void > >
+		{
+		public:
+			PoolHelper( Task::detail::move_only_function< void() >&& function,Task::cancellation_token token,Task::qos e ) :
+				m_function( std::move( function ) ),
+				m_qos( e ),
+				m_future( nullptr,
+					  [ this ](){ this->start() ; },
+					  [ this ](){ if( !m_future.started() ){ this->deleteLater() ; } },
+					  [ this ](){ m_function() ; this->deleteLater() ; },
+					  std::move( token ) )
+			{
+			}
+			future< void >& Future()
+			{
+				return m_future ;
+			}
+		private:
+			~PoolHelper()
+			{
+				m_future.run() ;
+			}
+			void start()
+			{
+				thread_pool::instance( m_qos ).submit( [ this ](){
+
+					m_function() ;
+					this->deleteLater() ;
+				} ) ;
+			}
+			Task::detail::move_only_function< void() > m_function ;
+			Task::qos m_qos ;
+			future< void > m_future ;
+		};
+		template< typename T >
+		class ThreadHelper : public QThread
+		{
+		public:
+			ThreadHelper( Task::detail::move_only_function< T() >&& function,Task::cancellation_token token,Task::qos e ) :
+				m_function( std::move( function ) ),
+				m_qos( e ),
+				m_future( this,
+					  [ this ](){ this->start( Task::detail::thread_priority( m_qos ) ) ; },
+					  [ this ](){ if( !m_future.started() ){ this->deleteLater() ; } },
+					  [ this ](){ this->deleteLater() ; return m_function() ; },
+					  std::move( token ) )
+			{
+				connect( this,&QThread::finished,this,&QThread::deleteLater ) ;
+			}
+			future<T>& Future()
+			{
+				return m_future ;
+			}
+		private:
+			~ThreadHelper()
+			{
+				m_future.run( std::move( m_result ) ) ;
+			}
+			void run()
+			{
+				Task::detail::set_thread_nice( m_qos ) ;
+
+				m_result = m_function() ;
+			}
+			Task::detail::move_only_function< T() > m_function ;
+			Task::qos m_qos ;
+			future<T> m_future ;
+			T m_result ;
+		};
+
+		template<>
+		class ThreadHelper< void > : public QThread
+		{
+		public:
+			ThreadHelper( Task::detail::move_only_function< void() >&& function,Task::cancellation_token token,Task::qos e ) :
+				m_function( std::move( function ) ),
+				m_qos( e ),
+				m_future( this,
+					  [ this ](){ this->start( Task::detail::thread_priority( m_qos ) ) ; },
+					  [ this ](){ if( !m_future.started() ){ this->deleteLater() ; } },
+					  [ this ](){ m_function() ; this->deleteLater() ; },
+					  std::move( token ) )
+			{
+				connect( this,&QThread::finished,this,&QThread::deleteLater ) ;
+			}
+			future< void >& Future()
 			{
 				return m_future ;
 			}
@@ -699,16 +1451,27 @@ namespace Task
 			}
 			void run()
 			{
+				Task::detail::set_thread_nice( m_qos ) ;
+
 				m_function() ;
 			}
-			std::function< void() > m_function ;
+			Task::detail::move_only_function< void() > m_function ;
+			Task::qos m_qos ;
 			future< void > m_future ;
 		};
 		template< typename Fn >
-		Task::future<typename std::result_of<Fn()>::type>& run( Fn function )
+		Task::future<typename std::result_of<Fn()>::type>& run( Fn function,
+									 Task::cancellation_token token = nullptr,
+									 Task::qos e = Task::detail::current_qos() )
 		{
 			using fn_t = typename std::result_of<Fn()>::type ;
-			return ( new ThreadHelper<fn_t>( std::move( function ) ) )->Future() ;
+
+			if( Task::detail::policy() == static_cast< int >( Task::execution_policy::thread_per_task ) ){
+
+				return ( new ThreadHelper<fn_t>( std::move( function ),std::move( token ),e ) )->Future() ;
+			}else{
+				return ( new PoolHelper<fn_t>( std::move( function ),std::move( token ),e ) )->Future() ;
+			}
 		}
 
 		template< typename T >
@@ -778,6 +1541,263 @@ namespace Task
 			add_pair_void( f,std::forward<T>( t ) ... ) ;
 		}
 
+		template< std::size_t ... I >
+		struct sequence
+		{
+		};
+
+		template< std::size_t N,std::size_t ... I >
+		struct make_sequence : make_sequence< N - 1,N - 1,I ... >
+		{
+		};
+
+		template< std::size_t ... I >
+		struct make_sequence< 0,I ... >
+		{
+			using type = sequence< I ... > ;
+		};
+
+		template< typename ... T >
+		class WhenAllHelper : public QObject,public Task::detail::recyclable< WhenAllHelper< T ... > >
+		{
+		public:
+			using result_type = std::tuple< T ... > ;
+			using indexes = typename make_sequence< sizeof ... ( T ) >::type ;
+
+			WhenAllHelper( Task::future< T >& ... e ) :
+				m_futures( std::addressof( e ) ... ),
+				m_future( nullptr,
+					  [ this ](){ this->start( indexes() ) ; },
+					  [ this ](){ this->cancel( indexes() ) ; },
+					  [ this ](){ this->deleteLater() ; return this->get( indexes() ) ; } )
+			{
+			}
+			Task::future< result_type >& Future()
+			{
+				return m_future ;
+			}
+		private:
+			~WhenAllHelper()
+			{
+				m_future.run( std::move( m_result ) ) ;
+			}
+			template< std::size_t ... I >
+			void start( sequence< I ... > )
+			{
+				int e[] = { ( this->start_one< I >(),0 ) ... } ;
+				Q_UNUSED( e ) ;
+			}
+			template< std::size_t I >
+			void start_one()
+			{
+				using type = typename std::tuple_element< I,result_type >::type ;
+
+				std::get< I >( m_futures )->then( [ this ]( type&& e ){
+
+					std::get< I >( m_result ) = std::move( e ) ;
+
+					if( ++m_counter == sizeof ... ( T ) ){
+
+						this->deleteLater() ;
+					}
+				} ) ;
+			}
+			template< std::size_t ... I >
+			void cancel( sequence< I ... > )
+			{
+				int e[] = { ( std::get< I >( m_futures )->cancel(),0 ) ... } ;
+				Q_UNUSED( e ) ;
+
+				if( !m_future.started() ){
+
+					this->deleteLater() ;
+				}
+			}
+			template< std::size_t ... I >
+			result_type get( sequence< I ... > )
+			{
+				return result_type{ std::get< I >( m_futures )->get() ... } ;
+			}
+			std::tuple< Task::future< T > * ... > m_futures ;
+			result_type m_result ;
+			std::atomic< std::size_t > m_counter{ 0 } ;
+			Task::future< result_type > m_future ;
+		};
+
+		template< typename T >
+		class WhenAllVectorHelper : public QObject,public Task::detail::recyclable< WhenAllVectorHelper< T > >
+		{
+		public:
+			WhenAllVectorHelper( std::vector< Task::future< T > * >&& e ) :
+				m_futures( std::move( e ) ),
+				m_result( m_futures.size() ),
+				m_future( nullptr,
+					  [ this ](){ this->start() ; },
+					  [ this ](){ this->cancel() ; },
+					  [ this ](){ this->deleteLater() ; return this->get() ; } )
+			{
+			}
+			Task::future< std::vector< T > >& Future()
+			{
+				return m_future ;
+			}
+		private:
+			~WhenAllVectorHelper()
+			{
+				m_future.run( std::move( m_result ) ) ;
+			}
+			void start()
+			{
+				if( m_futures.empty() ){
+
+					this->deleteLater() ;
+				}
+
+				for( std::size_t i = 0 ; i < m_futures.size() ; i++ ){
+
+					m_futures[ i ]->then( [ this,i ]( T&& e ){
+
+						m_result[ i ] = std::move( e ) ;
+
+						if( ++m_counter == m_futures.size() ){
+
+							this->deleteLater() ;
+						}
+					} ) ;
+				}
+			}
+			void cancel()
+			{
+				for( auto it : m_futures ){
+
+					it->cancel() ;
+				}
+
+				if( !m_future.started() ){
+
+					this->deleteLater() ;
+				}
+			}
+			std::vector< T > get()
+			{
+				for( std::size_t i = 0 ; i < m_futures.size() ; i++ ){
+
+					m_result[ i ] = m_futures[ i ]->get() ;
+				}
+
+				return std::move( m_result ) ;
+			}
+			std::vector< Task::future< T > * > m_futures ;
+			std::vector< T > m_result ;
+			std::atomic< std::size_t > m_counter{ 0 } ;
+			Task::future< std::vector< T > > m_future ;
+		};
+
+		template< typename T >
+		class WhenAnyHelper : public QObject,public Task::detail::recyclable< WhenAnyHelper< T > >
+		{
+		public:
+			using result_type = std::pair< std::size_t,T > ;
+
+			WhenAnyHelper( std::vector< Task::future< T > * >&& e ) :
+				m_futures( std::move( e ) ),
+				m_future( nullptr,
+					  [ this ](){ this->start() ; },
+					  [ this ](){ this->cancel() ; },
+					  [ this ](){ this->deleteLater() ; return this->get() ; } )
+			{
+			}
+			Task::future< result_type >& Future()
+			{
+				return m_future ;
+			}
+		private:
+			~WhenAnyHelper()
+			{
+				if( !m_done ){
+
+					m_future.run( std::move( m_result ) ) ;
+				}
+			}
+			void start()
+			{
+				if( m_futures.empty() ){
+
+					this->deleteLater() ;
+				}
+
+				for( std::size_t i = 0 ; i < m_futures.size() ; i++ ){
+
+					m_futures[ i ]->then( [ this,i ]( T&& e ){
+
+						/*
+						 * The first result is delivered right away,this object stays
+						 * around until the remaining futures finish.
+						 */
+						if( !m_done.exchange( true ) ){
+
+							m_future.run( result_type( i,std::move( e ) ) ) ;
+						}
+
+						if( ++m_counter == m_futures.size() ){
+
+							this->deleteLater() ;
+						}
+					} ) ;
+				}
+			}
+			void cancel()
+			{
+				for( auto it : m_futures ){
+
+					it->cancel() ;
+				}
+
+				if( !m_future.started() ){
+
+					this->deleteLater() ;
+				}
+			}
+			/*
+			 * .get() runs futures one after another in the calling thread and there is
+			 * nothing to race,the first one is run and the others are cancelled.
+			 */
+			result_type get()
+			{
+				if( m_futures.empty() ){
+
+					return result_type() ;
+				}
+
+				for( std::size_t i = 1 ; i < m_futures.size() ; i++ ){
+
+					m_futures[ i ]->cancel() ;
+				}
+
+				return result_type( 0,m_futures[ 0 ]->get() ) ;
+			}
+			std::vector< Task::future< T > * > m_futures ;
+			result_type m_result ;
+			std::atomic< std::size_t > m_counter{ 0 } ;
+			std::atomic< bool > m_done{ false } ;
+			Task::future< result_type > m_future ;
+		};
+
+		template< typename T >
+		std::vector< Task::future< T > * > pointers( const std::vector< std::reference_wrapper< Task::future< T > > >& e )
+		{
+			std::vector< Task::future< T > * > s ;
+
+			s.reserve( e.size() ) ;
+
+			for( auto& it : e ){
+
+				s.emplace_back( std::addressof( it.get() ) ) ;
+			}
+
+			return s ;
+		}
+
 		template< typename T >
 		Task::future< T >& future()
 		{
@@ -791,6 +1811,54 @@ namespace Task
 	 * -------------------------End of internal helper functions-------------------------
 	 */
 
+	/*
+	 * Select how futures created after this call are run.Futures that already exist are
+	 * not affected.
+	 */
+	static inline void set_execution_policy( Task::execution_policy e )
+	{
+		Task::detail::policy() = static_cast< int >( e ) ;
+	}
+
+	static inline Task::execution_policy get_execution_policy()
+	{
+		return static_cast< Task::execution_policy >( Task::detail::policy().load() ) ;
+	}
+
+#if TASK_HAS_COROUTINES
+	/*
+	 * Return type of a coroutine that uses "co_await" on futures.The coroutine starts running
+	 * when called,returns to its caller on the first suspension and cleans up after itself
+	 * when it finish running.
+	 */
+	class coroutine
+	{
+	public:
+		struct promise_type
+		{
+			Task::coroutine get_return_object() noexcept
+			{
+				return {} ;
+			}
+			std::suspend_never initial_suspend() noexcept
+			{
+				return {} ;
+			}
+			std::suspend_never final_suspend() noexcept
+			{
+				return {} ;
+			}
+			void return_void() noexcept
+			{
+			}
+			void unhandled_exception() noexcept
+			{
+				std::terminate() ;
+			}
+		};
+	};
+#endif
+
 	template< typename Fn >
 	future<typename std::result_of<Fn()>::type>& run( Fn function )
 	{
@@ -803,6 +1871,25 @@ namespace Task
 		return Task::run( std::bind( std::move( function ),std::move( args ) ... ) ) ;
 	}
 
+	/*
+	 * Run a function with a given quality of service.
+	 */
+	template< typename Fn >
+	future<typename std::result_of<Fn()>::type>& run( Task::qos e,Fn function )
+	{
+		return Task::detail::run( std::move( function ),nullptr,e ) ;
+	}
+
+	/*
+	 * Run a function that takes a cancellation token.Calling .cancel() on the returned future
+	 * cancels the token.
+	 */
+	template< typename Fn >
+	future<typename std::result_of<Fn( const Task::cancellation_token& )>::type>& run( Task::cancellation_token token,Fn function )
+	{
+		return Task::detail::run( [ token,function ]()mutable{ return function( token ) ; },token ) ;
+	}
+
 	class progress : public QObject{
 		Q_OBJECT
 	public:
@@ -811,17 +1898,158 @@ namespace Task
 		{
 			connect( this,&progress::update,obj,std::move( fn ) ) ;
 		}
-	signals:
-		void update( QVariant x ) const ;
+	signals:
+		void update( QVariant x ) const ;
+	private:
+	};
+
+	template< typename Fn,typename cb >
+	future<typename std::result_of<Fn( const progress& )>::type>& run( QObject * obj,Fn function,cb rp )
+	{
+		return Task::run( [ obj,rp = std::move( rp ),function = std::move( function ) ](){
+
+			return function( progress( obj,std::move( rp ) ) ) ;
+		} ) ;
+	}
+
+	namespace detail
+	{
+		class progress_notifier : public QObject
+		{
+			Q_OBJECT
+		signals:
+			void ready( int delay ) const ;
+		};
+	}
+
+	/*
+	 * A typed and rate limited alternative to Task::progress.
+	 *
+	 * "update()" only stores the value and at most one delivery to the receiver is in flight,
+	 * values reported while a delivery is pending replace each other and the receiver sees
+	 * the latest one.Deliveries are at least "interval" apart and the last value reported is
+	 * delivered before the continuation of the task runs.
+	 */
+	template< typename T >
+	class typed_progress
+	{
+	public:
+		template< typename Fn >
+		typed_progress( QObject * obj,Fn function,std::chrono::milliseconds interval ) :
+			m_state( std::make_shared< state >( std::move( function ),interval ) )
+		{
+			auto s = m_state ;
+
+			QObject::connect( s->notifier.get(),&Task::detail::progress_notifier::ready,obj,[ s,obj ]( int delay ){
+
+				if( delay > 0 ){
+
+					QTimer::singleShot( delay,obj,[ s ](){ s->deliver() ; } ) ;
+				}else{
+					s->deliver() ;
+				}
+
+			},Qt::QueuedConnection ) ;
+		}
+		typed_progress( const typed_progress& ) = delete ;
+		typed_progress& operator=( const typed_progress& ) = delete ;
+		~typed_progress()
+		{
+			{
+				std::lock_guard< std::mutex > lock( m_state->mutex ) ;
+
+				if( m_state->has_value ){
+
+					m_state->pending = true ;
+					m_state->notifier->ready( 0 ) ;
+				}
+			}
+
+			/*
+			 * Deliveries already queued keep the state alive until they run.
+			 */
+			m_state->notifier.reset() ;
+		}
+		void update( T e ) const
+		{
+			std::lock_guard< std::mutex > lock( m_state->mutex ) ;
+
+			auto& s = *m_state ;
+
+			s.value = std::move( e ) ;
+			s.has_value = true ;
+
+			if( !s.pending ){
+
+				s.pending = true ;
+
+				auto elapsed = std::chrono::duration_cast< std::chrono::milliseconds >( clock::now() - s.last ) ;
+
+				if( elapsed >= s.interval ){
+
+					s.notifier->ready( 0 ) ;
+				}else{
+					s.notifier->ready( static_cast< int >( ( s.interval - elapsed ).count() ) ) ;
+				}
+			}
+		}
 	private:
+		using clock = std::chrono::steady_clock ;
+
+		struct state
+		{
+			template< typename Fn >
+			state( Fn function,std::chrono::milliseconds e ) :
+				function( std::move( function ) ),
+				notifier( new Task::detail::progress_notifier() ),
+				interval( e )
+			{
+			}
+			void deliver()
+			{
+				std::unique_lock< std::mutex > lock( mutex ) ;
+
+				pending = false ;
+
+				if( has_value ){
+
+					T e = std::move( value ) ;
+
+					has_value = false ;
+					last = clock::now() ;
+
+					lock.unlock() ;
+
+					function( e ) ;
+				}
+			}
+			std::function< void( const T& ) > function ;
+			std::unique_ptr< Task::detail::progress_notifier > notifier ;
+			std::chrono::milliseconds interval ;
+			std::mutex mutex ;
+			T value ;
+			bool has_value = false ;
+			bool pending = false ;
+			clock::time_point last ;
+		};
+		std::shared_ptr< state > m_state ;
 	};
 
-	template< typename Fn,typename cb >
-	future<typename std::result_of<Fn( const progress& )>::type>& run( QObject * obj,Fn function,cb rp )
+	/*
+	 * Run a function that reports progress of type T,ie:
+	 *
+	 * Task::run< int >( this,[]( const Task::typed_progress< int >& p ){ p.update( 50 ) ; },
+	 *		    [ this ]( const int& e ){ this->setPercent( e ) ; } ) ;
+	 */
+	template< typename T,typename Fn,typename cb >
+	future<typename std::result_of<Fn( const typed_progress< T >& )>::type>& run( QObject * obj,
+										      Fn function,
+										      cb rp,
+										      std::chrono::milliseconds interval = std::chrono::milliseconds( 100 ) )
 	{
-		return Task::run( [ obj,rp = std::move( rp ),function = std::move( function ) ](){
+		return Task::run( [ obj,rp,function,interval ](){
 
-			return function( progress( obj,std::move( rp ) ) ) ;
+			return function( typed_progress< T >( obj,rp,interval ) ) ;
 		} ) ;
 	}
 
@@ -857,6 +2085,48 @@ namespace Task
 		return e ;
 	}
 
+
+	/*
+	 * Combine futures into one whose result is a tuple with results of all of them
+	 * in the order they were given.
+	 */
+	template< typename ... T >
+	Task::future< std::tuple< T ... > >& when_all( Task::future< T >& ... e )
+	{
+		return ( new Task::detail::WhenAllHelper< T ... >( e ... ) )->Future() ;
+	}
+
+	/*
+	 * Combine futures of the same type into one whose result is a vector with results
+	 * of all of them in the order they were given.
+	 */
+	template< typename T >
+	Task::future< std::vector< T > >& when_all( const std::vector< std::reference_wrapper< Task::future< T > > >& e )
+	{
+		return ( new Task::detail::WhenAllVectorHelper< T >( Task::detail::pointers( e ) ) )->Future() ;
+	}
+
+	/*
+	 * Combine futures of the same type into one whose result is the result of the first
+	 * future to finish and its position in the list.
+	 *
+	 * Nothing races when the combined future is run with .get(),the first future is run in
+	 * the current thread,the others are cancelled and the result always has position 0.
+	 */
+	template< typename T >
+	Task::future< std::pair< std::size_t,T > >& when_any( const std::vector< std::reference_wrapper< Task::future< T > > >& e )
+	{
+		return ( new Task::detail::WhenAnyHelper< T >( Task::detail::pointers( e ) ) )->Future() ;
+	}
+
+	template< typename T,typename ... E >
+	Task::future< std::pair< std::size_t,T > >& when_any( Task::future< T >& s,E& ... e )
+	{
+		std::vector< Task::future< T > * > m{ std::addressof( s ),std::addressof( e ) ... } ;
+
+		return ( new Task::detail::WhenAnyHelper< T >( std::move( m ) ) )->Future() ;
+	}
+
 	/*
 	 *
 	 * A few useful helper functions
@@ -910,6 +2180,344 @@ namespace Task
 		e.start() ;
 	}
 
+	namespace detail
+	{
+		class stream_notifier : public QObject
+		{
+			Q_OBJECT
+		signals:
+			void ready() const ;
+		};
+	}
+
+	/*
+	 * A bounded channel that carries values of type T from producers to consumers running
+	 * in other threads.Copies of a stream share the same channel.
+	 *
+	 * "send()" blocks while the channel holds "capacity()" values and "receive()" blocks while
+	 * it is empty,a fast producer is therefore held back by a slow consumer and memory use
+	 * stays bounded."close()" wakes up everybody that is blocked,values already in the channel
+	 * can still be received after the channel is closed.
+	 *
+	 * A stream should be consumed either with "receive()" or with "consume()",not both.
+	 */
+	template< typename T >
+	class stream
+	{
+	public:
+		explicit stream( std::size_t capacity = 64 ) :
+			m_state( std::make_shared< state >( capacity ) )
+		{
+		}
+		/*
+		 * Wait until there is room and add a value.Returns false if the stream is closed.
+		 */
+		bool send( T e ) const
+		{
+			std::unique_lock< std::mutex > lock( m_state->mutex ) ;
+
+			auto& s = *m_state ;
+
+			s.not_full.wait( lock,[ & ](){ return s.closed || s.queue.size() < s.capacity ; } ) ;
+
+			return s.push( std::move( e ) ) ;
+		}
+		/*
+		 * Add a value if there is room without waiting.The value is only moved from when
+		 * it was added.
+		 */
+		bool try_send( T&& e ) const
+		{
+			return this->try_push( std::move( e ) ) ;
+		}
+		bool try_send( const T& e ) const
+		{
+			return this->try_push( e ) ;
+		}
+		/*
+		 * Wait for a value.Returns false if the stream is closed and there are no more values.
+		 */
+		bool receive( T& e ) const
+		{
+			std::unique_lock< std::mutex > lock( m_state->mutex ) ;
+
+			auto& s = *m_state ;
+
+			s.not_empty.wait( lock,[ & ](){ return s.closed || !s.queue.empty() ; } ) ;
+
+			return s.pop( e ) ;
+		}
+		/*
+		 * Wait for at least one value and then take up to "max" of them.Returns false if the
+		 * stream is closed and there are no more values.
+		 */
+		bool receive( std::vector< T >& e,std::size_t max ) const
+		{
+			std::unique_lock< std::mutex > lock( m_state->mutex ) ;
+
+			auto& s = *m_state ;
+
+			s.not_empty.wait( lock,[ & ](){ return s.closed || !s.queue.empty() ; } ) ;
+
+			return s.pop( e,max ) > 0 ;
+		}
+		bool try_receive( T& e ) const
+		{
+			std::lock_guard< std::mutex > lock( m_state->mutex ) ;
+
+			return m_state->pop( e ) ;
+		}
+		/*
+		 * "send()" and "receive()" run as tasks,the returned futures can be used with
+		 * .then() or co_await without blocking the current thread.A task waiting on a full
+		 * or an empty stream occupies a worker until it is woken up.
+		 */
+		Task::future< bool >& async_send( T e ) const ;
+		Task::future< std::pair< bool,T > >& async_receive() const ;
+		/*
+		 * Deliver values to "batch" in the thread "obj" lives in,normally the GUI thread.
+		 * Values that arrive while a batch is being delivered are collected into the next
+		 * batch of up to "max" values so a fast producer does not flood the event queue with
+		 * one event per value."done" is called once after the stream is closed and all of
+		 * its values were delivered.Nothing is delivered after "obj" is deleted.
+		 */
+		template< typename Batch,typename Done >
+		void consume( QObject * obj,Batch batch,Done done,std::size_t max = 64 ) const
+		{
+			auto s = m_state ;
+
+			if( max == 0 ){
+
+				max = 1 ;
+			}
+
+			std::lock_guard< std::mutex > lock( s->mutex ) ;
+
+			s->notifier.reset( new Task::detail::stream_notifier() ) ;
+
+			std::weak_ptr< state > w = s ;
+
+			/*
+			 * The channel owns the notifier and hence the slot,the slot therefore only holds
+			 * a weak reference to it.A channel whose handles are all gone is kept alive by
+			 * "keep_alive" while a delivery is queued and so it is drained before it goes away.
+			 */
+			QObject::connect( s->notifier.get(),&Task::detail::stream_notifier::ready,obj,[ w,batch,done,max ]()mutable{
+
+				auto s = w.lock() ;
+
+				if( !s ){
+
+					return ;
+				}
+
+				std::vector< T > e ;
+
+				bool finished ;
+
+				{
+					std::lock_guard< std::mutex > lock( s->mutex ) ;
+
+					s->pop( e,max ) ;
+
+					if( s->queue.empty() ){
+
+						s->pending = false ;
+						s->keep_alive.reset() ;
+					}else{
+						s->notifier->ready() ;
+					}
+
+					finished = s->closed && s->queue.empty() && s->notifier ;
+
+					if( finished ){
+
+						s->notifier.release()->deleteLater() ;
+					}
+				}
+
+				if( !e.empty() ){
+
+					batch( std::move( e ) ) ;
+				}
+
+				if( finished ){
+
+					done() ;
+				}
+
+			},Qt::QueuedConnection ) ;
+
+			/*
+			 * A delivery queued to a deleted object never runs and would keep the channel alive
+			 */
+			QObject::connect( obj,&QObject::destroyed,[ w ](){
+
+				if( auto s = w.lock() ){
+
+					std::lock_guard< std::mutex > lock( s->mutex ) ;
+
+					if( s->notifier ){
+
+						s->notifier.release()->deleteLater() ;
+					}
+
+					s->keep_alive.reset() ;
+				}
+			} ) ;
+
+			if( s->closed || !s->queue.empty() ){
+
+				s->notify() ;
+			}
+		}
+		void close() const
+		{
+			std::lock_guard< std::mutex > lock( m_state->mutex ) ;
+
+			auto& s = *m_state ;
+
+			s.closed = true ;
+
+			s.not_full.notify_all() ;
+			s.not_empty.notify_all() ;
+			s.notify() ;
+		}
+		bool closed() const
+		{
+			std::lock_guard< std::mutex > lock( m_state->mutex ) ;
+
+			return m_state->closed ;
+		}
+		std::size_t size() const
+		{
+			std::lock_guard< std::mutex > lock( m_state->mutex ) ;
+
+			return m_state->queue.size() ;
+		}
+		std::size_t capacity() const
+		{
+			return m_state->capacity ;
+		}
+	private:
+		template< typename E >
+		bool try_push( E&& e ) const
+		{
+			std::lock_guard< std::mutex > lock( m_state->mutex ) ;
+
+			auto& s = *m_state ;
+
+			if( s.queue.size() < s.capacity ){
+
+				return s.push( std::forward< E >( e ) ) ;
+			}else{
+				return false ;
+			}
+		}
+		/*
+		 * All members are protected by "mutex".
+		 */
+		struct state : std::enable_shared_from_this< state >
+		{
+			state( std::size_t e ) : capacity( e > 0 ? e : 1 )
+			{
+			}
+			template< typename E >
+			bool push( E&& e )
+			{
+				if( closed ){
+
+					return false ;
+				}
+
+				queue.emplace_back( std::forward< E >( e ) ) ;
+
+				not_empty.notify_one() ;
+
+				this->notify() ;
+
+				return true ;
+			}
+			bool pop( T& e )
+			{
+				if( queue.empty() ){
+
+					return false ;
+				}
+
+				e = std::move( queue.front() ) ;
+				queue.pop_front() ;
+
+				not_full.notify_one() ;
+
+				return true ;
+			}
+			std::size_t pop( std::vector< T >& e,std::size_t max )
+			{
+				std::size_t count = 0 ;
+
+				while( !queue.empty() && count < max ){
+
+					e.emplace_back( std::move( queue.front() ) ) ;
+					queue.pop_front() ;
+					count++ ;
+				}
+
+				if( count > 0 ){
+
+					not_full.notify_all() ;
+				}
+
+				return count ;
+			}
+			/*
+			 * At most one delivery to a consumer is queued at any time.
+			 */
+			void notify()
+			{
+				if( notifier && !pending ){
+
+					pending = true ;
+					keep_alive = this->shared_from_this() ;
+					notifier->ready() ;
+				}
+			}
+			std::mutex mutex ;
+			std::condition_variable not_full ;
+			std::condition_variable not_empty ;
+			std::deque< T > queue ;
+			std::size_t capacity ;
+			bool closed = false ;
+			bool pending = false ;
+			std::unique_ptr< Task::detail::stream_notifier > notifier ;
+			std::shared_ptr< state > keep_alive ;
+		};
+		std::shared_ptr< state > m_state ;
+	};
+
+	template< typename T >
+	Task::future< bool >& stream< T >::async_send( T e ) const
+	{
+		auto s = *this ;
+
+		return Task::run( [ s,e ]()mutable{ return s.send( std::move( e ) ) ; } ) ;
+	}
+
+	template< typename T >
+	Task::future< std::pair< bool,T > >& stream< T >::async_receive() const
+	{
+		auto s = *this ;
+
+		return Task::run( [ s ](){
+
+			std::pair< bool,T > e ;
+
+			e.first = s.receive( e.second ) ;
+
+			return e ;
+		} ) ;
+	}
+
 	namespace process {
 
 		class result{
@@ -942,6 +2550,51 @@ namespace Task
 				m_exitCode   = e.exitCode() ;
 				m_exitStatus = e.exitStatus() ;
 			}
+			/*
+			 * Wait for the process to finish for up to "s" milliseconds(-1 means no limit)
+			 * or until the token is cancelled.A process that did not finish in time is sent
+			 * SIGTERM and then SIGKILL if it is still running after a grace period.
+			 */
+			result( QProcess& e,int s,const Task::cancellation_token& token )
+			{
+				auto start = std::chrono::steady_clock::now() ;
+
+				while( true ){
+
+					if( e.waitForFinished( 100 ) ){
+
+						m_finished = true ;
+						break ;
+					}
+
+					if( e.state() == QProcess::NotRunning ){
+
+						m_finished = false ;
+						break ;
+					}
+
+					auto elapsed = std::chrono::steady_clock::now() - start ;
+
+					if( token.cancelled() || ( s >= 0 && elapsed >= std::chrono::milliseconds( s ) ) ){
+
+						e.terminate() ;
+
+						if( !e.waitForFinished( 5000 ) ){
+
+							e.kill() ;
+							e.waitForFinished( -1 ) ;
+						}
+
+						m_finished = false ;
+						break ;
+					}
+				}
+
+				m_stdOut     = e.readAllStandardOutput() ;
+				m_stdError   = e.readAllStandardError() ;
+				m_exitCode   = e.exitCode() ;
+				m_exitStatus = e.exitStatus() ;
+			}
 			const QByteArray& std_out() const
 			{
 				return m_stdOut ;
@@ -980,14 +2633,18 @@ namespace Task
 			int m_exitStatus = 255 ;
 		};
 
+		/*
+		 * Calling .cancel() on the returned future terminates the process.
+		 */
 		static inline Task::future< result >& run( const QString& cmd,
-							   const QStringList& args = QStringList(),
+							   const QStringList& args,
+							   Task::cancellation_token token,
 							   int waitTime = -1,
 							   const QByteArray& password = QByteArray(),
 							   const QProcessEnvironment& env = QProcessEnvironment(),
 							   std::function< void() > setUp_child_process = [](){} )
 		{
-			return Task::run( [ = ](){
+			return Task::run( std::move( token ),[ = ]( const Task::cancellation_token& token ){
 
 				class Process : public QProcess{
 				public:
@@ -1021,10 +2678,20 @@ namespace Task
 					exe.closeWriteChannel() ;
 				}
 
-				return result( exe,waitTime ) ;
+				return result( exe,waitTime,token ) ;
 			} ) ;
 		}
 
+		static inline Task::future< result >& run( const QString& cmd,
+							   const QStringList& args = QStringList(),
+							   int waitTime = -1,
+							   const QByteArray& password = QByteArray(),
+							   const QProcessEnvironment& env = QProcessEnvironment(),
+							   std::function< void() > setUp_child_process = [](){} )
+		{
+			return Task::process::run( cmd,args,Task::cancellation_token(),waitTime,password,env,std::move( setUp_child_process ) ) ;
+		}
+
 		static inline Task::future< result >& run( const QString& cmd,const QByteArray& password )
 		{
 			return Task::process::run( cmd,{},-1,password ) ;
@@ -0,0 +1,664 @@
+/*
+ *
+ *  Copyright (c) 2014
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "announcementfeed.h"
+#include "settings.h"
+
+#include <QFile>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QSet>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+/*
+ * The number of items that are kept and shown.
+ */
+static const int _maxItems = 50 ;
+
+feed::parser::~parser()
+{
+}
+
+std::unique_ptr< feed::parser > feed::parser::make( const QByteArray& e )
+{
+	for( char c : e ){
+
+		if( c == '<' ){
+
+			return std::unique_ptr< feed::parser >( new feed::xmlParser() ) ;
+
+		}else if( c == '[' || c == '{' ){
+
+			return std::unique_ptr< feed::parser >( new feed::jsonParser() ) ;
+
+		}else if( c != ' ' && c != '\t' && c != '\r' && c != '\n' ){
+
+			/*
+			 * Byte order mark or garbage,let the XML parser decide
+			 */
+			return std::unique_ptr< feed::parser >( new feed::xmlParser() ) ;
+		}
+	}
+
+	return nullptr ;
+}
+
+bool feed::xmlParser::parse( const QByteArray& e,const feed::parser::function& function )
+{
+	if( m_stopped ){
+
+		return false ;
+	}
+
+	m_reader.addData( e ) ;
+
+	while( true ){
+
+		auto token = m_reader.readNext() ;
+
+		if( token == QXmlStreamReader::Invalid ){
+
+			if( m_reader.error() == QXmlStreamReader::PrematureEndOfDocumentError ){
+
+				/*
+				 * Wait for more data
+				 */
+				return true ;
+			}else{
+				m_stopped = true ;
+				return false ;
+			}
+
+		}else if( token == QXmlStreamReader::EndDocument ){
+
+			return true ;
+
+		}else if( token == QXmlStreamReader::StartElement ){
+
+			auto name = m_reader.name() ;
+
+			if( name == "item" || name == "entry" ){
+
+				m_inItem = true ;
+
+				m_id.clear() ;
+				m_title.clear() ;
+				m_content.clear() ;
+				m_date.clear() ;
+				m_link.clear() ;
+
+			}else if( m_inItem ){
+
+				m_text.clear() ;
+
+				if( name == "link" && m_link.isEmpty() ){
+
+					m_link = m_reader.attributes().value( "href" ).toString() ;
+				}
+			}
+
+		}else if( token == QXmlStreamReader::Characters ){
+
+			if( m_inItem ){
+
+				m_text += m_reader.text() ;
+			}
+
+		}else if( token == QXmlStreamReader::EndElement ){
+
+			auto name = m_reader.name() ;
+
+			if( name == "item" || name == "entry" ){
+
+				m_inItem = false ;
+
+				feed::item s ;
+
+				if( !m_id.isEmpty() ){
+
+					s.id = m_id ;
+
+				}else if( !m_link.isEmpty() ){
+
+					s.id = m_link ;
+				}else{
+					s.id = m_title ;
+				}
+
+				s.date = m_date ;
+
+				if( m_content.isEmpty() ){
+
+					s.text = m_title ;
+				}else{
+					s.text = m_title + "\n" + m_content ;
+				}
+
+				if( !function( s ) ){
+
+					m_stopped = true ;
+					return false ;
+				}
+
+			}else if( m_inItem ){
+
+				this->endField( name ) ;
+			}
+		}
+	}
+}
+
+void feed::xmlParser::endField( const QStringRef& name )
+{
+	auto text = m_text.trimmed() ;
+
+	if( name == "guid" || name == "id" ){
+
+		m_id = text ;
+
+	}else if( name == "title" ){
+
+		m_title = text ;
+
+	}else if( name == "description" || name == "summary" || name == "content" || name == "encoded" ){
+
+		if( m_content.isEmpty() ){
+
+			m_content = text ;
+		}
+
+	}else if( name == "pubDate" || name == "updated" || name == "published" || name == "date" ){
+
+		if( m_date.isEmpty() ){
+
+			m_date = text ;
+		}
+
+	}else if( name == "link" ){
+
+		if( m_link.isEmpty() ){
+
+			m_link = text ;
+		}
+	}
+}
+
+bool feed::jsonParser::parse( const QByteArray& e,const feed::parser::function& function )
+{
+	if( m_stopped ){
+
+		return false ;
+	}
+
+	for( char c : e ){
+
+		if( m_collecting ){
+
+			m_object += c ;
+		}
+
+		if( m_inString ){
+
+			if( m_escape ){
+
+				m_escape = false ;
+
+			}else if( c == '\\' ){
+
+				m_escape = true ;
+
+			}else if( c == '"' ){
+
+				m_inString = false ;
+
+			}else if( !m_collecting && m_depth == 1 ){
+
+				m_key += c ;
+			}
+
+			continue ;
+		}
+
+		if( c == '"' ){
+
+			m_inString = true ;
+			m_key.clear() ;
+
+		}else if( c == ':' && !m_collecting && m_depth == 1 ){
+
+			/*
+			 * Only a string followed by a colon is a key,a value like "items" is not
+			 */
+			m_lastKey = m_key ;
+
+		}else if( c == ',' && !m_collecting && m_depth == 1 ){
+
+			m_lastKey.clear() ;
+
+		}else if( c == '{' || c == '[' ){
+
+			m_depth++ ;
+
+			if( m_depth == 1 ){
+
+				m_topLevelIsObject = c == '{' ;
+
+				if( c == '[' ){
+
+					m_itemsDepth = 1 ;
+				}
+
+			}else if( c == '[' && m_depth == 2 && m_itemsDepth == -1 && m_topLevelIsObject && m_lastKey == "items" ){
+
+				m_itemsDepth = 2 ;
+
+			}else if( c == '{' && !m_collecting && m_itemsDepth > 0 && m_depth == m_itemsDepth + 1 ){
+
+				m_collecting = true ;
+				m_object = "{" ;
+			}
+
+		}else if( c == '}' || c == ']' ){
+
+			if( m_collecting && c == '}' && m_depth == m_itemsDepth + 1 ){
+
+				m_collecting = false ;
+
+				feed::item s ;
+
+				if( this->object( m_object,s ) && !function( s ) ){
+
+					m_stopped = true ;
+					return false ;
+				}
+
+				m_object.clear() ;
+			}
+
+			m_depth-- ;
+		}
+	}
+
+	return true ;
+}
+
+static QString _string( const QJsonObject& e,const char * a,const char * b )
+{
+	auto s = e.value( a ).toString() ;
+
+	if( s.isEmpty() ){
+
+		return e.value( b ).toString() ;
+	}else{
+		return s ;
+	}
+}
+
+bool feed::jsonParser::object( const QByteArray& e,feed::item& s )
+{
+	auto doc = QJsonDocument::fromJson( e ) ;
+
+	if( !doc.isObject() ){
+
+		return false ;
+	}
+
+	auto obj = doc.object() ;
+
+	auto id = obj.value( "id_str" ) ;
+
+	if( !id.isString() ){
+
+		id = obj.value( "id" ) ;
+	}
+
+	if( id.isDouble() ){
+
+		s.id = QString::number( static_cast< qint64 >( id.toDouble() ) ) ;
+	}else{
+		s.id = id.toString() ;
+	}
+
+	s.date = _string( obj,"created_at","date_published" ) ;
+
+	auto text = obj.value( "text" ).toString() ;
+
+	if( text.isEmpty() ){
+
+		auto title   = obj.value( "title" ).toString() ;
+		auto content = _string( obj,"content_text","summary" ) ;
+
+		if( title.isEmpty() ){
+
+			text = content ;
+
+		}else if( content.isEmpty() ){
+
+			text = title ;
+		}else{
+			text = title + "\n" + content ;
+		}
+	}
+
+	s.text = text ;
+
+	return true ;
+}
+
+announcementFeed::announcementFeed( NetworkAccessManager& e ) : m_manager( e )
+{
+	connect( &m_timer,&QTimer::timeout,this,&announcementFeed::poll ) ;
+}
+
+void announcementFeed::start()
+{
+	m_url      = settings::url() ;
+	m_lastSeen = settings::lastAnnouncement() ;
+
+	this->load() ;
+
+	m_timer.start( settings::announcementFeedPollInterval() ) ;
+
+	QTimer::singleShot( settings::delayTimeBeforeUpdateCheck(),this,[ this ](){ this->poll() ; } ) ;
+}
+
+void announcementFeed::poll()
+{
+	this->request( QNetworkRequest::LowPriority ) ;
+}
+
+void announcementFeed::pollNow()
+{
+	this->request( QNetworkRequest::HighPriority ) ;
+}
+
+void announcementFeed::request( QNetworkRequest::Priority priority )
+{
+	if( m_polling ){
+
+		/*
+		 * A poll from the schedule may still wait for a connection when the user asks for
+		 * the feed,it then goes ahead as if pollNow() made it
+		 */
+		m_manager.raisePriority( m_request,priority ) ;
+
+		return ;
+	}
+
+	m_polling = true ;
+
+	m_parser.reset() ;
+	m_pending.clear() ;
+	m_newItems.clear() ;
+	m_reachedLastSeen = false ;
+	m_newCount = 0 ;
+
+	QUrl url( m_url ) ;
+
+	auto cursor = settings::announcementFeedCursor() ;
+
+	if( !cursor.isEmpty() ){
+
+		/*
+		 * validators are kept for the feed and not for every value the cursor takes
+		 */
+		m_manager.ignoreQueryItemInValidators( cursor ) ;
+	}
+
+	/*
+	 * When we already have items,ask the server for newer ones only if it knows how to
+	 */
+	if( !cursor.isEmpty() && !m_items.isEmpty() && !m_lastSeen.isEmpty() ){
+
+		QUrlQuery q( url ) ;
+
+		q.removeAllQueryItems( cursor ) ;
+		q.addQueryItem( cursor,m_lastSeen ) ;
+
+		url.setQuery( q ) ;
+	}
+
+	QNetworkRequest s( url ) ;
+
+	s.setRawHeader( "User-Agent","qt-update-notifier" ) ;
+	s.setPriority( priority ) ;
+
+	if( url.host() == "api.twitter.com" ){
+
+		s.setRawHeader( "Authorization",settings::token() ) ;
+	}
+
+	if( !m_items.isEmpty() ){
+
+		s = m_manager.ifModified( s ) ;
+	}
+
+	m_request = s ;
+
+	m_manager.getStream( 30,s,[ this ]( QNetworkReply& e ){
+
+		return this->data( e ) ;
+
+	},[ this ]( QNetworkReply& e ){
+
+		this->finished( e ) ;
+
+	},[ this ](){
+
+		m_polling = false ;
+
+		emit failed() ;
+	} ) ;
+}
+
+bool announcementFeed::data( QNetworkReply& e )
+{
+	auto code = e.attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() ;
+
+	/*
+	 * The status code is 0 for local files
+	 */
+	if( code != 200 && code != 0 ){
+
+		return true ;
+	}
+
+	auto s = e.readAll() ;
+
+	if( !m_parser ){
+
+		m_pending += s ;
+
+		m_parser = feed::parser::make( m_pending ) ;
+
+		if( !m_parser ){
+
+			return true ;
+		}
+
+		s = m_pending ;
+
+		m_pending.clear() ;
+	}
+
+	return m_parser->parse( s,[ this ]( const feed::item& e ){
+
+		if( !m_lastSeen.isEmpty() && e.id == m_lastSeen ){
+
+			if( !m_items.isEmpty() ){
+
+				/*
+				 * Everything from here on was seen by an earlier poll
+				 */
+				return false ;
+			}
+
+			m_reachedLastSeen = true ;
+		}
+
+		if( !m_reachedLastSeen ){
+
+			m_newCount++ ;
+		}
+
+		m_newItems.append( e ) ;
+
+		return m_newItems.size() < _maxItems ;
+	} ) ;
+}
+
+void announcementFeed::finished( QNetworkReply& e )
+{
+	m_polling = false ;
+
+	m_parser.reset() ;
+	m_pending.clear() ;
+
+	if( e.error() != QNetworkReply::NoError ){
+
+		emit failed() ;
+
+		return ;
+	}
+
+	if( NetworkAccessManager::notModified( e ) ){
+
+		emit updated() ;
+
+		return ;
+	}
+
+	auto code = e.attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() ;
+
+	if( code != 200 && code != 0 ){
+
+		emit failed() ;
+
+		return ;
+	}
+
+	if( !m_newItems.isEmpty() ){
+
+		for( int i = 0 ; i < m_newCount ; i++ ){
+
+			const auto& s = m_newItems.at( i ).text ;
+
+			if( s.contains( "ANNOUNCEMENT" ) ){
+
+				emit announcement( s ) ;
+			}
+		}
+
+		QSet< QString > ids ;
+
+		for( const auto& it : m_newItems ){
+
+			ids.insert( it.id ) ;
+		}
+
+		for( const auto& it : m_items ){
+
+			if( m_newItems.size() >= _maxItems ){
+
+				break ;
+			}
+
+			if( !ids.contains( it.id ) ){
+
+				m_newItems.append( it ) ;
+			}
+		}
+
+		m_items = std::move( m_newItems ) ;
+		m_newItems.clear() ;
+
+		m_lastSeen = m_items.first().id ;
+
+		settings::setLastAnnouncement( m_lastSeen ) ;
+
+		this->save() ;
+	}
+
+	emit updated() ;
+}
+
+QString announcementFeed::text()
+{
+	QString e ;
+
+	for( const auto& it : m_items ){
+
+		e += "\n" + it.date + ":\n" + it.text + "\n" ;
+	}
+
+	return e ;
+}
+
+static QString _itemsPath()
+{
+	return settings::configPath() + "/announcements.json" ;
+}
+
+void announcementFeed::load()
+{
+	QFile f( _itemsPath() ) ;
+
+	if( f.open( QIODevice::ReadOnly ) ){
+
+		m_items.clear() ;
+
+		for( const auto& it : QJsonDocument::fromJson( f.readAll() ).array() ){
+
+			auto obj = it.toObject() ;
+
+			feed::item s ;
+
+			s.id   = obj.value( "id" ).toString() ;
+			s.date = obj.value( "date" ).toString() ;
+			s.text = obj.value( "text" ).toString() ;
+
+			m_items.append( s ) ;
+		}
+	}
+}
+
+void announcementFeed::save()
+{
+	QJsonArray e ;
+
+	for( const auto& it : m_items ){
+
+		QJsonObject obj ;
+
+		obj.insert( "id",it.id ) ;
+		obj.insert( "date",it.date ) ;
+		obj.insert( "text",it.text ) ;
+
+		e.append( obj ) ;
+	}
+
+	QFile f( _itemsPath() ) ;
+
+	if( f.open( QIODevice::WriteOnly | QIODevice::Truncate ) ){
+
+		f.write( QJsonDocument( e ).toJson( QJsonDocument::Compact ) ) ;
+	}
+}
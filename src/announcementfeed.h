@@ -0,0 +1,149 @@
+/*
+ *
+ *  Copyright (c) 2014
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANNOUNCEMENTFEED_H
+#define ANNOUNCEMENTFEED_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QTimer>
+#include <QXmlStreamReader>
+
+#include <functional>
+#include <memory>
+
+#include "networkAccessManager.hpp"
+
+namespace feed
+{
+	struct item
+	{
+		QString id ;
+		QString date ;
+		QString text ;
+	};
+
+	/*
+	 * A parser is given the body of a feed a part at a time as it arrives and reports items
+	 * in the order they appear in the feed.Parsing stops when the callback returns false.
+	 */
+	class parser
+	{
+	public:
+		using function = std::function< bool( const feed::item& ) > ;
+		/*
+		 * Returns nullptr if "e" does not yet tell what kind of a feed this is.
+		 */
+		static std::unique_ptr< feed::parser > make( const QByteArray& e ) ;
+		/*
+		 * Returns false once parsing stopped.
+		 */
+		virtual bool parse( const QByteArray&,const feed::parser::function& ) = 0 ;
+		virtual ~parser() ;
+	};
+
+	/*
+	 * RSS "item" and Atom "entry" elements.
+	 */
+	class xmlParser : public feed::parser
+	{
+	public:
+		bool parse( const QByteArray&,const feed::parser::function& ) override ;
+	private:
+		void endField( const QStringRef& ) ;
+		QXmlStreamReader m_reader ;
+		bool m_inItem = false ;
+		bool m_stopped = false ;
+		QString m_text ;
+		QString m_id ;
+		QString m_title ;
+		QString m_content ;
+		QString m_date ;
+		QString m_link ;
+	};
+
+	/*
+	 * Objects of a top level array(ie Twitter statuses) or of the "items" array of a JSON
+	 * feed(https://jsonfeed.org).Each object is parsed as soon as its closing brace arrives.
+	 */
+	class jsonParser : public feed::parser
+	{
+	public:
+		bool parse( const QByteArray&,const feed::parser::function& ) override ;
+	private:
+		bool object( const QByteArray&,feed::item& ) ;
+		int m_depth = 0 ;
+		int m_itemsDepth = -1 ;
+		bool m_topLevelIsObject = false ;
+		bool m_inString = false ;
+		bool m_escape = false ;
+		bool m_collecting = false ;
+		bool m_stopped = false ;
+		QByteArray m_key ;
+		QByteArray m_lastKey ;
+		QByteArray m_object ;
+	};
+}
+
+/*
+ * Polls the announcement feed in the background.Items are stored on disk,newest first,and
+ * a poll only parses the feed up to the newest item seen by an earlier poll.
+ */
+class announcementFeed : public QObject
+{
+	Q_OBJECT
+public:
+	announcementFeed( NetworkAccessManager& ) ;
+	void start( void ) ;
+	QString text( void ) ;
+public slots:
+	/*
+	 * poll() is used by the background schedule and pollNow() when the user asked for the feed,
+	 * its request goes ahead of other queued requests to the same host,including a poll() that
+	 * still waits for a connection.
+	 */
+	void poll( void ) ;
+	void pollNow( void ) ;
+signals:
+	void updated( void ) ;
+	void failed( void ) ;
+	void announcement( QString ) ;
+private:
+	void request( QNetworkRequest::Priority ) ;
+	bool data( QNetworkReply& ) ;
+	void finished( QNetworkReply& ) ;
+	void load( void ) ;
+	void save( void ) ;
+	NetworkAccessManager& m_manager ;
+	QTimer m_timer ;
+	bool m_polling = false ;
+	bool m_reachedLastSeen = false ;
+	int m_newCount = 0 ;
+	QString m_url ;
+	QString m_lastSeen ;
+	QNetworkRequest m_request ;
+	QList< feed::item > m_items ;
+	QList< feed::item > m_newItems ;
+	QByteArray m_pending ;
+	std::unique_ptr< feed::parser > m_parser ;
+};
+
+#endif // ANNOUNCEMENTFEED_H
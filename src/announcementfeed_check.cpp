@@ -0,0 +1,173 @@
+/*
+ *
+ *  Copyright (c) 2014
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Feeds the announcement feed parsers with feeds cut into parts at every byte boundary and
+ * checks that they report the same items,newest first,and stop at the newest item seen by an
+ * earlier poll.
+ */
+
+#include "announcementfeed.h"
+
+#include <QStringList>
+
+#include <iostream>
+
+static int _failures = 0 ;
+
+static void _check( bool e,const QString& name,const QString& what )
+{
+	if( !e ){
+
+		_failures++ ;
+
+		std::cout << "FAILED: " << name.toStdString() << ": " << what.toStdString() << std::endl ;
+	}
+}
+
+/*
+ * Gives "e" to a parser in parts that end at the given offsets and returns the ids of the
+ * items reported before the one with the id "lastSeen".
+ */
+static QStringList _parse( const QByteArray& e,const std::vector< int >& cuts,const QString& lastSeen,QStringList& texts )
+{
+	QStringList ids ;
+
+	std::unique_ptr< feed::parser > parser ;
+
+	QByteArray pending ;
+
+	auto function = [ & ]( const feed::item& s ){
+
+		if( s.id == lastSeen ){
+
+			return false ;
+		}
+
+		ids.append( s.id ) ;
+		texts.append( s.text ) ;
+
+		return true ;
+	} ;
+
+	int start = 0 ;
+
+	auto offsets = cuts ;
+
+	offsets.emplace_back( e.size() ) ;
+
+	for( auto end : offsets ){
+
+		auto part = e.mid( start,end - start ) ;
+
+		start = end ;
+
+		if( !parser ){
+
+			pending += part ;
+
+			parser = feed::parser::make( pending ) ;
+
+			if( !parser ){
+
+				continue ;
+			}
+
+			part = pending ;
+		}
+
+		if( !parser->parse( part,function ) ){
+
+			break ;
+		}
+	}
+
+	return ids ;
+}
+
+static void _test( const QString& name,const QByteArray& e,const QString& lastSeen,
+		   const QStringList& ids,const QStringList& texts )
+{
+	auto check = [ & ]( const std::vector< int >& cuts,const QString& how ){
+
+		QStringList t ;
+
+		auto m = _parse( e,cuts,lastSeen,t ) ;
+
+		_check( m == ids,name,how + ",got ids: " + m.join( "," ) ) ;
+		_check( t == texts,name,how + ",got texts: " + t.join( "|" ) ) ;
+	} ;
+
+	check( {},"in one part" ) ;
+
+	for( int i = 1 ; i < e.size() ; i++ ){
+
+		check( { i },"cut at byte " + QString::number( i ) ) ;
+	}
+
+	std::vector< int > bytes ;
+
+	for( int i = 1 ; i < e.size() ; i++ ){
+
+		bytes.emplace_back( i ) ;
+	}
+
+	check( bytes,"a byte at a time" ) ;
+}
+
+int main()
+{
+	_test( "rss",
+	       R"(<?xml version="1.0"?><rss><channel><title>items</title>)"
+	       R"(<item><guid>3</guid><title>Third &amp; "quoted"</title></item>)"
+	       R"(<item><guid>2</guid><title>Second</title></item>)"
+	       R"(<item><guid>1</guid><title>First</title></item></channel></rss>)",
+	       "2",{ "3" },{ "Third & \"quoted\"" } ) ;
+
+	_test( "atom",
+	       R"(<feed xmlns="http://www.w3.org/2005/Atom"><entry><id>b</id><title>B</title>)"
+	       R"(<summary>more</summary></entry><entry><id>a</id><title>A</title></entry></feed>)",
+	       "a",{ "b" },{ "B\nmore" } ) ;
+
+	/*
+	 * A top level value equal to "items",escaped quotes and braces in strings and an "items"
+	 * key in an object that is not at the top level
+	 */
+	_test( "json feed",
+	       R"({"version":"items","title":"a \"items\" [feed] {x}","meta":{"items":[{"id":"9"}]},)"
+	       R"("items":[{"id":"3","title":"say \"}\" here"},{"id":"2","content_text":"two"},{"id":"1"}]})",
+	       "2",{ "3" },{ "say \"}\" here" } ) ;
+
+	_test( "json feed without the last seen id",
+	       R"({"title":"items","items":[{"id":"3","title":"three"},{"id":"2","title":"two"}]})",
+	       "1",{ "3","2" },{ "three","two" } ) ;
+
+	_test( "twitter",
+	       R"([{"id_str":"30","text":"a \\ \"b\" ]"},{"id":20,"text":"c"},{"id_str":"10","text":"d"}])",
+	       "10",{ "30","20" },{ "a \\ \"b\" ]","c" } ) ;
+
+	if( _failures == 0 ){
+
+		std::cout << "all announcement feed parser checks passed" << std::endl ;
+
+		return 0 ;
+	}else{
+		return 1 ;
+	}
+}
@@ -108,9 +108,11 @@ void configureDialog::closeUI()
 
 		this->delayTimeChanged( m_ui->gbDelayStartIntervalComboBox->currentIndex() ) ;
 
-		if( duration * 1000 != settings::updateCheckInterval() ){
+		auto interval = static_cast< qint64 >( duration ) * 1000 ;
 
-			emit setUpdateInterval( duration * 1000 ) ;
+		if( interval != settings::updateCheckInterval() ){
+
+			emit setUpdateInterval( interval ) ;
 			emit configOptionsChanged() ;
 			settings::setNextUpdateInterval( QString::number( duration ) ) ;
 		}
@@ -49,7 +49,7 @@ public:
 	void showUI() ;
 signals:
 	void toggleAutoStart( bool ) ;
-	void setUpdateInterval( int ) ;
+	void setUpdateInterval( qint64 ) ;
 	void configOptionsChanged( void ) ;
 	void localizationLanguage( QString ) ;
 	void autoReshreshSynaptic( bool ) ;
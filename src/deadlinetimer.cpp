@@ -0,0 +1,175 @@
+/*
+ *
+ *  Copyright (c) 2014
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "deadlinetimer.h"
+
+#include <QDateTime>
+#include <QDebug>
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET ( 1 << 1 )
+#endif
+
+/*
+ * Without a timerfd,the time left is measured again at least this often so that a suspend
+ * delays the timer by no more than this much.
+ */
+static const qint64 _fallbackInterval = 60 * 1000 ;
+
+deadlineTimer::deadlineTimer( QObject * parent ) :
+	QObject( parent ),m_fd( timerfd_create( CLOCK_REALTIME,TFD_NONBLOCK | TFD_CLOEXEC ) )
+{
+	if( m_fd == -1 ){
+
+		qDebug() << "timerfd_create() failed,falling back to polling:" << strerror( errno ) ;
+
+		m_fallback.setSingleShot( true ) ;
+
+		connect( &m_fallback,SIGNAL( timeout() ),this,SLOT( expired() ) ) ;
+	}else{
+		m_notifier = new QSocketNotifier( m_fd,QSocketNotifier::Read,this ) ;
+
+		connect( m_notifier,SIGNAL( activated( int ) ),this,SLOT( expired() ) ) ;
+	}
+}
+
+deadlineTimer::~deadlineTimer()
+{
+	if( m_fd != -1 ){
+
+		delete m_notifier ;
+
+		::close( m_fd ) ;
+	}
+}
+
+void deadlineTimer::start( qint64 deadline )
+{
+	m_deadline = deadline ;
+	m_active   = true ;
+
+	this->arm() ;
+}
+
+void deadlineTimer::stop()
+{
+	m_active = false ;
+
+	if( m_fd == -1 ){
+
+		m_fallback.stop() ;
+	}else{
+		struct itimerspec s ;
+
+		memset( &s,0,sizeof( s ) ) ;
+
+		timerfd_settime( m_fd,0,&s,nullptr ) ;
+	}
+}
+
+bool deadlineTimer::isActive() const
+{
+	return m_active ;
+}
+
+qint64 deadlineTimer::deadline() const
+{
+	return m_deadline ;
+}
+
+void deadlineTimer::arm()
+{
+	if( m_fd == -1 ){
+
+		auto s = m_deadline - QDateTime::currentMSecsSinceEpoch() ;
+
+		m_fallback.start( static_cast< int >( std::max( std::min( s,_fallbackInterval ),static_cast< qint64 >( 0 ) ) ) ) ;
+
+		return ;
+	}
+
+	struct itimerspec s ;
+
+	memset( &s,0,sizeof( s ) ) ;
+
+	if( m_deadline > 0 ){
+
+		s.it_value.tv_sec  = static_cast< time_t >( m_deadline / 1000 ) ;
+		s.it_value.tv_nsec = static_cast< long >( m_deadline % 1000 ) * 1000 * 1000 ;
+	}else{
+		/*
+		 * An all zero time disarms the timer
+		 */
+		s.it_value.tv_nsec = 1 ;
+	}
+
+	if( timerfd_settime( m_fd,TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,&s,nullptr ) == -1 ){
+
+		qDebug() << "timerfd_settime() failed:" << strerror( errno ) ;
+	}
+}
+
+void deadlineTimer::expired()
+{
+	if( m_fd == -1 ){
+
+		if( !m_active ){
+
+			return ;
+		}
+
+		if( QDateTime::currentMSecsSinceEpoch() < m_deadline ){
+
+			return this->arm() ;
+		}
+	}else{
+		quint64 expirations ;
+
+		if( ::read( m_fd,&expirations,sizeof( expirations ) ) == -1 ){
+
+			if( errno == ECANCELED && m_active ){
+
+				/*
+				 * The clock was set and the kernel cancelled the timer,it is armed again
+				 * and fires right away if the new time is past the deadline
+				 */
+				this->arm() ;
+			}
+
+			return ;
+		}
+
+		if( !m_active ){
+
+			return ;
+		}
+	}
+
+	m_active = false ;
+
+	emit timeout() ;
+}
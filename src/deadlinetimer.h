@@ -0,0 +1,61 @@
+/*
+ *
+ *  Copyright (c) 2014
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEADLINETIMER_H
+#define DEADLINETIMER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QSocketNotifier>
+
+/*
+ * A single shot timer that fires at a wall clock time given in milliseconds since the epoch.
+ *
+ * It is a timerfd on CLOCK_REALTIME.A QTimer measures its interval on a clock that does not move
+ * while the computer is suspended and an int interval can not be longer than 24 days,this timer
+ * fires as soon as the computer resumes if its time passed while it was asleep and it is armed
+ * again for the same time when the clock is set.
+ */
+class deadlineTimer : public QObject
+{
+	Q_OBJECT
+public:
+	deadlineTimer( QObject * parent = nullptr ) ;
+	~deadlineTimer() ;
+	/*
+	 * A time that already passed fires the timer right away.
+	 */
+	void start( qint64 deadline ) ;
+	void stop( void ) ;
+	bool isActive( void ) const ;
+	qint64 deadline( void ) const ;
+signals:
+	void timeout( void ) ;
+private slots:
+	void expired( void ) ;
+private:
+	void arm( void ) ;
+	int m_fd ;
+	bool m_active = false ;
+	qint64 m_deadline = 0 ;
+	QSocketNotifier * m_notifier = nullptr ;
+	QTimer m_fallback ;
+};
+
+#endif // DEADLINETIMER_H
@@ -21,7 +21,7 @@
 #include "logwindow.h"
 #include "ui_logwindow.h"
 #include <QDebug>
-logWindow::logWindow( QString title,QWidget * parent ) :QWidget( parent ),m_ui( new Ui::logWindow )
+logWindow::logWindow( QString title,QWidget * parent ) :QWidget( parent ),m_ui( new Ui::logWindow ),m_title( title )
 {
 	m_ui->setupUi( this ) ;
 	this->setWindowTitle( title ) ;
@@ -98,6 +98,16 @@ void logWindow::updateLogWindow_1()
         m_ui->textEditLogField->setText( utility::readFromFile( m_logPath ) ) ;
 }
 
+void logWindow::updateProgress( QString e )
+{
+	if( e.isEmpty() ){
+
+		this->setWindowTitle( m_title ) ;
+	}else{
+		this->setWindowTitle( QString( "%1 - %2" ).arg( m_title,e ) ) ;
+	}
+}
+
 void logWindow::pbClearLog()
 {
 	m_ui->textEditLogField->clear() ;
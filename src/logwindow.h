@@ -47,12 +47,14 @@ private slots:
 	void pbQuit( void ) ;
 	void updateLogWindow( void ) ;
 	void updateLogWindow_1( void ) ;
+	void updateProgress( QString ) ;
 private:
 	void closeEvent( QCloseEvent * ) ;
 	bool eventFilter( QObject * watched,QEvent * event ) ;
 	Ui::logWindow * m_ui;
 	QString m_logFile ;
 	QString m_logPath ;
+	QString m_title ;
 	enum class windowType{ logWindow,aptGetWindow } m_windowType ;
 };
 
@@ -34,8 +34,13 @@
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
 #include <grp.h>
 
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+
 struct ProcessType_t{
 	pid_t pid ;
 	int fd_0[ 2 ] ; /* this variable is used to write to child process      */
@@ -128,6 +133,10 @@ static process_t _process( const char * path )
 	p->str.env = NULL   ;
 	p->str.user_id = -1 ;
 	p->str.priority = 0 ;
+	p->str.io_class = 0 ;
+	p->str.io_level = 0 ;
+	p->str.cgroup = NULL ;
+	p->str.inherit_fd = -1 ;
 	p->str.signal = SIGTERM ;
 	p->state = ProcessHasNotStarted ;
 	return p ;
@@ -268,6 +277,63 @@ void ProcessSetOptionPriority( process_t p,int priority )
 	}
 }
 
+void ProcessSetOptionIoPriority( process_t p,int io_class,int io_level )
+{
+	if( p != ProcessVoid ){
+		p->str.io_class = io_class ;
+		p->str.io_level = io_level ;
+	}
+}
+
+void ProcessSetOptionCgroup( process_t p,const char * cgroup )
+{
+	if( p != ProcessVoid ){
+		p->str.cgroup = cgroup ;
+	}
+}
+
+void ProcessSetOptionInheritFd( process_t p,int fd )
+{
+	if( p != ProcessVoid ){
+		p->str.inherit_fd = fd ;
+	}
+}
+
+int ProcessHasExited( process_t p )
+{
+	siginfo_t info ;
+
+	if( p == ProcessVoid || p->state == ProcessHasNotStarted || p->state == ProcessCompleted ){
+		return 1 ;
+	}
+
+	memset( &info,'\0',sizeof( info ) ) ;
+
+	if( waitid( P_PID,p->pid,&info,WEXITED|WNOHANG|WNOWAIT ) == -1 ){
+		return 1 ;
+	}
+
+	return info.si_pid != 0 ;
+}
+
+static void __ProcessJoinCgroup( const char * cgroup )
+{
+	char path[ 4096 ] ;
+	int fd ;
+
+	snprintf( path,sizeof( path ),"%s/cgroup.procs",cgroup ) ;
+
+	fd = open( path,O_WRONLY ) ;
+
+	if( fd != -1 ){
+		/*
+		 * writing "0" moves the writing process
+		 */
+		write( fd,"0",1 ) ;
+		close( fd ) ;
+	}
+}
+
 pid_t ProcessStart( process_t p )
 {
 	const char * exe ;
@@ -288,6 +354,16 @@ pid_t ProcessStart( process_t p )
 		return -1 ;
 	}
 	if( p->pid == 0 ){
+		if( p->str.cgroup != NULL ){
+			__ProcessJoinCgroup( p->str.cgroup ) ;
+		}
+		if( p->str.inherit_fd != -1 ){
+			fcntl( p->str.inherit_fd,F_SETFD,0 ) ;
+		}
+		if( p->str.io_class != 0 ){
+			syscall( SYS_ioprio_set,IOPRIO_WHO_PROCESS,0,
+				 ( p->str.io_class << IOPRIO_CLASS_SHIFT ) | p->str.io_level ) ;
+		}
 		if( p->str.user_id != ( uid_t )-1 ){
 			/*
 			 * drop privileges permanently
@@ -426,6 +502,20 @@ size_t ProcessGetOutPut( process_t p,char ** data,ProcessIO std_io )
 	return size ;
 }
 
+int ProcessGetFileDescriptor( process_t p,ProcessIO std_io )
+{
+	if( p != ProcessVoid ){
+		switch( std_io ){
+			case ProcessStdIn    : return p->fd_0[ 1 ] ;
+			case ProcessStdOut   : return p->fd_1[ 0 ] ;
+			case ProcessStdError : return p->fd_2[ 0 ] ;
+			default              : return -1 ;
+		}
+	}else{
+		return -1 ;
+	}
+}
+
 ProcessStatus ProcessState( process_t p )
 {
 	if( p != ProcessVoid ){
@@ -439,8 +529,8 @@ ssize_t ProcessGetOutPut_1( process_t p,char * buffer,int size,ProcessIO std_io
 {
 	if( p != ProcessVoid ){
 		switch( std_io ){
-			case ProcessStdOut   : return read( p->fd_1[ 1 ],buffer,size ) ;
-			case ProcessStdError : return read( p->fd_2[ 1 ],buffer,size ) ;
+			case ProcessStdOut   : return read( p->fd_1[ 0 ],buffer,size ) ;
+			case ProcessStdError : return read( p->fd_2[ 0 ],buffer,size ) ;
 			default              : return -1 ;
 		}
 	}else{
@@ -566,7 +656,11 @@ int ProcessExitStatus( process_t p )
 	if( p == ProcessVoid ){
 		return -1 ;
 	}else{
-		waitpid( p->pid,&s,0 ) ;
+		if( waitpid( p->pid,&s,0 ) == -1 ){
+			p->state = ProcessCompleted ;
+			p->wait_status = 1 ;
+			return -1 ;
+		}
 
 		p->state = ProcessCompleted ;
 		p->wait_status = 1 ;
@@ -52,6 +52,22 @@ typedef struct{
 	 * priority of forked process will run with
 	 */
 	int priority ;
+	/*
+	 * I/O scheduling class and level the forked process will run with,see ioprio_set(2).
+	 * io_class 0 means leave it alone.
+	 */
+	int io_class ;
+	int io_level ;
+	/*
+	 * If this variable is set,the forked process will move itself into this cgroup v2 directory
+	 * before it executes.
+	 */
+	const char * cgroup ;
+	/*
+	 * If this variable is not -1,this close on exec file descriptor is left open in the forked
+	 * process.
+	 */
+	int inherit_fd ;
 }ProcessStructure ;
 
 typedef struct ProcessType_t * process_t ;
@@ -115,6 +131,31 @@ void ProcessSetOptionUser( process_t,uid_t uid ) ;
  */
 void ProcessSetOptionPriority( process_t,int priority ) ;
 
+/*
+ * set the I/O scheduling class and level the forked process will run with.
+ * class: 1 - realtime,2 - best effort,3 - idle.
+ * level: 0(highest) to 7(lowest),ignored for the idle class.
+ */
+void ProcessSetOptionIoPriority( process_t,int io_class,int io_level ) ;
+
+/*
+ * set a cgroup v2 directory(ie "/sys/fs/cgroup/foo") the forked process will join before it executes.
+ * The string is not copied and must remain valid until ProcessStart() returns.
+ */
+void ProcessSetOptionCgroup( process_t,const char * cgroup ) ;
+
+/*
+ * keep a file descriptor that was opened with O_CLOEXEC open in the forked process,ie the
+ * write end of a pipe the forked process reports to.All others stay closed on exec.
+ */
+void ProcessSetOptionInheritFd( process_t,int fd ) ;
+
+/*
+ * return 1 if the forked process has exited,the process is not reaped and its exit status
+ * can still be collected with ProcessWaitUntilFinished()
+ */
+int ProcessHasExited( process_t ) ;
+
 /*
  * send a forked process sigkill to kill it
  */
@@ -201,6 +242,12 @@ size_t ProcessGetOutPut( process_t,char ** data,ProcessIO ) ;
  */
 ssize_t ProcessGetOutPut_1( process_t,char * buffer,int size,ProcessIO ) ;
 
+/*
+ * get the parent's end of the pipe connected to std in/std out/std error of the forked process.
+ * Useful for polling the forked process together with other file descriptors.
+ */
+int ProcessGetFileDescriptor( process_t,ProcessIO ) ;
+
 #ifdef __cplusplus
 }
 #endif
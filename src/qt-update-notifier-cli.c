@@ -30,49 +30,70 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 
 #include "version.h"
 
 #include "kdesu_path.h"
+#include "qt-update-synaptic-helper.h"
 #include "process.h"
 
 #define DEBUG 1
 
 #define PRIORITY -15
 
+#define OUTPUT_CHUNK_SIZE 4096
+
 static const char * groupName = "qtupdatenotifier" ;
 
 #define stringsAreEqual( x,y ) strcmp( x,y ) == 0
 #define stringContains( x,y ) strstr( x,y ) != NULL
 
-static int userHasPermission( void )
-{
-	char ** entry ;
-	char * name   ;
-
-	uid_t uid = getuid() ;
-
-	struct group * grp ;
-
-	struct passwd * pass ;
+/*
+ * Results of passwd and group lookups are cached per user because they can be slow
+ * when they are served over the network(LDAP,NIS etc).The cache mostly matters in helper
+ * service mode where the same user makes many requests over the life of the process.
+ */
+#define USER_CACHE_SIZE 32
+#define USER_CACHE_TTL  300
+#define USER_GROUPS_MAX 64
+
+typedef struct{
+	uid_t uid ;
+	gid_t gid ;
+	gid_t groups[ USER_GROUPS_MAX ] ;
+	int groupCount ;
+	int inUse ;
+	int hasPermission ;
+	time_t expires ;
+	char logPath[ 1024 ] ;
+	int logFd ;
+	ino_t logInode ;
+}userEntry_t ;
 
-	if( uid == 0 ){
-		return 1 ;
-	}
+static userEntry_t userCache[ USER_CACHE_SIZE ] ;
 
-	pass = getpwuid( uid ) ;
+/*
+ * user on whose behalf the current operation is being done.
+ */
+static uid_t requestUid ;
 
-	if( pass == NULL ){
-		return 0 ;
-	}
+static int userIsInGroup( const char * name )
+{
+	char ** entry ;
 
-	grp = getgrnam( groupName ) ;
+	struct group * grp = getgrnam( groupName ) ;
 
 	if( grp == NULL ){
 		return 0 ;
 	}
 
-	name  = pass->pw_name ;
 	entry = grp->gr_mem ;
 
 	while( *entry != NULL ){
@@ -88,17 +109,109 @@ static int userHasPermission( void )
 	return 0 ;
 }
 
-static int userHasNoPermission( void )
+static userEntry_t * lookupUser( uid_t uid )
 {
-	return userHasPermission() == 0 ;
+	struct passwd * pass ;
+
+	userEntry_t * e = NULL ;
+
+	time_t now = time( NULL ) ;
+
+	int i ;
+
+	for( i = 0 ; i < USER_CACHE_SIZE ; i++ ){
+
+		if( userCache[ i ].inUse && userCache[ i ].uid == uid ){
+
+			if( userCache[ i ].expires > now ){
+
+				return &userCache[ i ] ;
+			}else{
+				e = &userCache[ i ] ;
+				break ;
+			}
+		}
+	}
+
+	if( e == NULL ){
+
+		/*
+		 * use a free slot or evict the entry that expires first
+		 */
+		e = &userCache[ 0 ] ;
+
+		for( i = 0 ; i < USER_CACHE_SIZE ; i++ ){
+
+			if( !userCache[ i ].inUse ){
+
+				e = &userCache[ i ] ;
+				break ;
+
+			}else if( userCache[ i ].expires < e->expires ){
+
+				e = &userCache[ i ] ;
+			}
+		}
+
+		if( e->inUse && e->logFd != -1 ){
+
+			close( e->logFd ) ;
+		}
+
+		e->logFd = -1 ;
+	}
+
+	pass = getpwuid( uid ) ;
+
+	if( pass == NULL ){
+
+		if( e->logFd != -1 ){
+
+			close( e->logFd ) ;
+		}
+
+		e->inUse = 0 ;
+		e->logFd = -1 ;
+
+		return NULL ;
+	}
+
+	e->uid           = uid ;
+	e->gid           = pass->pw_gid ;
+	e->groupCount    = USER_GROUPS_MAX ;
+	e->inUse         = 1 ;
+	e->expires       = now + USER_CACHE_TTL ;
+	e->hasPermission = uid == 0 || userIsInGroup( pass->pw_name ) ;
+
+	/*
+	 * a user in more groups than fit gets the ones that fit,that only takes access away
+	 */
+	if( getgrouplist( pass->pw_name,pass->pw_gid,e->groups,&e->groupCount ) == -1 ){
+
+		e->groupCount = USER_GROUPS_MAX ;
+	}
+
+	snprintf( e->logPath,sizeof( e->logPath ),"/home/%s/.config/qt-update-notifier/backEnd.log",pass->pw_name ) ;
+
+	return e ;
 }
 
-static inline void printOUtPut( const char * e,int debug )
+static int userHasPermission( void )
 {
-	if( debug ){
+	userEntry_t * e ;
 
-		printf( "%s",e ) ;
+	if( requestUid == 0 ){
+		return 1 ;
 	}
+
+	e = lookupUser( requestUid ) ;
+
+	return e != NULL && e->hasPermission ;
+}
+
+static int userHasNoPermission( void )
+{
+	return userHasPermission() == 0 ;
 }
 
 static inline void logStage( int fd,const char * msg )
@@ -114,165 +227,1282 @@ static inline void logStage( int fd,const char * msg )
 	write( fd,e,s ) ;
 }
 
-static int itIsSafeToUpdate( const char * e,int debug )
+static void setDefaultLanguageToEnglish( void )
 {
-	const char * error1 = "The following packages have unmet dependencies" ;
-	const char * error2 = "E: Error, pkgProblemResolver::Resolve generated breaks, this may be caused by held packages." ;
-	const char * error3 = "The following packages have been kept back" ;
+	setenv( "LANG","en_US.UTF-8",1 ) ;
+	setenv( "LANGUAGE","en_US.UTF-8",1 ) ;
+}
 
-	const char * success = "\nThe following packages will be" ;
+/*
+ * Scheduling options apt-get runs with can be changed by the administrator in a file that must
+ * be owned by root and not be writable by anybody else.Recognized options and their defaults:
+ *
+ * nice=-15                  nice value in the range -20 to 19.
+ * ionice=none               I/O scheduling class,one of "none","idle" or "best-effort[:level]".
+ * cgroup=false              if "true",run apt-get in a transient cgroup v2 with below limits,the cgroup is
+ *                           made below the one of this process and that one must be delegated to it.
+ * cpu.weight=               cgroup cpu weight,1 to 10000.
+ * io.weight=                cgroup io weight,1 to 10000.
+ * memory.high=              cgroup memory throttling limit,ie "512M" or "max".
+ */
+#define CONFIG_FILE "/etc/qt-update-notifier.conf"
 
-	const char * noUpdates = "0 upgraded, 0 newly installed, 0 removed and 0 not upgraded." ;
+#define CGROUP_ROOT "/sys/fs/cgroup"
 
-	printOUtPut( e,debug ) ;
+#define CGROUP_LEAF "/qt-update-notifier-cli"
+
+typedef struct{
+	int nice ;
+	int ioClass ;
+	int ioLevel ;
+	int useCgroup ;
+	char cpuWeight[ 32 ] ;
+	char ioWeight[ 32 ] ;
+	char memoryHigh[ 32 ] ;
+	char cgroupPath[ 384 ] ;
+}aptPriority_t ;
+
+static aptPriority_t aptPriority ;
+
+static int validCgroupValue( const char * e )
+{
+	if( *e == '\0' ){
 
-	if( e == NULL){
-		return 1 ;
-	}
-	if( stringContains( e,error1 ) ){
-		return 1 ;
-	}
-	if( stringContains( e,error2 ) ){
-		return 1 ;
-	}
-	if( stringContains( e,error3 ) ){
-		return 1 ;
-	}
-	if( stringContains( e,success ) ){
 		return 0 ;
 	}
-	if( stringContains( e,noUpdates ) ){
-		return 2 ;
+
+	while( *e ){
+
+		if( !( ( *e >= '0' && *e <= '9' ) || ( *e >= 'a' && *e <= 'z' ) || ( *e >= 'A' && *e <= 'Z' ) ) ){
+
+			return 0 ;
+		}
+
+		e++ ;
 	}
 
 	return 1 ;
 }
 
-static void setDefaultLanguageToEnglish( void )
+static void setCgroupValue( char * buffer,size_t size,const char * e )
 {
-	setenv( "LANG","en_US.UTF-8",1 ) ;
-	setenv( "LANGUAGE","en_US.UTF-8",1 ) ;
+	if( validCgroupValue( e ) && strlen( e ) < size ){
+
+		memcpy( buffer,e,strlen( e ) + 1 ) ;
+	}else{
+		printf( "warning: ignoring invalid cgroup value \"%s\"\n",e ) ;
+	}
 }
 
-static void printProcessOUtPut( process_t p,int fd,int debug )
+static void setAptPriorityOption( const char * key,const char * value )
 {
-	char * e ;
-	int z ;
+	int n ;
 
-	while( 1 ){
+	if( stringsAreEqual( key,"nice" ) ){
+
+		n = atoi( value ) ;
+
+		if( n >= -20 && n <= 19 ){
 
-		e = NULL ;
+			aptPriority.nice = n ;
+		}
+
+	}else if( stringsAreEqual( key,"ionice" ) ){
 
-		z = ProcessGetOutPut( p,&e,ProcessStdOut ) ;
+		if( stringsAreEqual( value,"idle" ) ){
 
-		if( e ){
+			aptPriority.ioClass = 3 ;
+			aptPriority.ioLevel = 0 ;
 
-			write( fd,e,z ) ;
+		}else if( strncmp( value,"best-effort",11 ) == 0 ){
 
-			printOUtPut( e,debug ) ;
+			aptPriority.ioClass = 2 ;
+			aptPriority.ioLevel = value[ 11 ] == ':' ? atoi( value + 12 ) : 4 ;
 
-			free( e ) ;
+			if( aptPriority.ioLevel < 0 || aptPriority.ioLevel > 7 ){
+
+				aptPriority.ioLevel = 4 ;
+			}
 		}else{
-			break ;
+			aptPriority.ioClass = 0 ;
 		}
+
+	}else if( stringsAreEqual( key,"cgroup" ) ){
+
+		aptPriority.useCgroup = stringsAreEqual( value,"true" ) ;
+
+	}else if( stringsAreEqual( key,"cpu.weight" ) ){
+
+		setCgroupValue( aptPriority.cpuWeight,sizeof( aptPriority.cpuWeight ),value ) ;
+
+	}else if( stringsAreEqual( key,"io.weight" ) ){
+
+		setCgroupValue( aptPriority.ioWeight,sizeof( aptPriority.ioWeight ),value ) ;
+
+	}else if( stringsAreEqual( key,"memory.high" ) ){
+
+		setCgroupValue( aptPriority.memoryHigh,sizeof( aptPriority.memoryHigh ),value ) ;
 	}
 }
 
-static int refreshPackageList( int fd,int debug )
+static void loadAptPriority( void )
 {
-	int r ;
+	char line[ 256 ] ;
 
-	process_t p ;
+	char * e ;
+	char * f ;
 
-	logStage( fd,"entering refreshPackageList" ) ;
+	struct stat st ;
 
-	if( userHasPermission() ){
+	FILE * file ;
 
-		p = Process( "/usr/bin/apt-get","update",NULL ) ;
+	memset( &aptPriority,'\0',sizeof( aptPriority ) ) ;
 
-		ProcessSetOptionUser( p,0 ) ;
-		ProcessSetOptionPriority( p,PRIORITY ) ;
+	aptPriority.nice = PRIORITY ;
 
-		ProcessStart( p ) ;
+	file = fopen( CONFIG_FILE,"r" ) ;
 
-		printProcessOUtPut( p,fd,debug ) ;
+	if( file == NULL ){
 
-		r = ProcessWaitUntilFinished( &p ) ;
-	}else{
-		printf( "error: insufficent privileges to perform this operation\n" ) ;
-		r = 1 ;
+		return ;
 	}
 
-	logStage( fd,"leaving refreshPackageList" ) ;
+	if( fstat( fileno( file ),&st ) != 0 || st.st_uid != 0 || ( st.st_mode & ( S_IWGRP | S_IWOTH ) ) ){
+
+		printf( "warning: ignoring \"%s\",it must be owned by root and writable only by root\n",CONFIG_FILE ) ;
+		fclose( file ) ;
+		return ;
+	}
+
+	while( fgets( line,sizeof( line ),file ) != NULL ){
+
+		line[ strcspn( line,"\r\n" ) ] = '\0' ;
+
+		if( *line == '#' ){
+
+			continue ;
+		}
+
+		e = strchr( line,'=' ) ;
+
+		if( e != NULL ){
+
+			*e = '\0' ;
+
+			for( f = e - 1 ; f >= line && *f == ' ' ; f-- ){
+
+				*f = '\0' ;
+			}
+
+			for( e = e + 1 ; *e == ' ' ; e++ ){}
+
+			setAptPriorityOption( line,e ) ;
+		}
+	}
+
+	fclose( file ) ;
+}
+
+static int writeCgroupFile( const char * cgroup,const char * name,const char * value )
+{
+	char path[ 512 ] ;
+
+	int fd ;
+	int r ;
+
+	snprintf( path,sizeof( path ),"%s/%s",cgroup,name ) ;
+
+	fd = open( path,O_WRONLY|O_CLOEXEC ) ;
+
+	r = fd != -1 && write( fd,value,strlen( value ) ) != -1 ;
+
+	if( !r ){
+
+		printf( "warning: failed to set \"%s\" to \"%s\"\n",path,value ) ;
+	}
+
+	if( fd != -1 ){
+
+		close( fd ) ;
+	}
 
 	return r ;
 }
 
-static int aptAndSynapticAreRunning( void )
+/*
+ * Path of the cgroup v2 this process runs in,read from "/proc/self/cgroup".The cgroup of apt-get
+ * is made below it and never below the root of the hierarchy,the root belongs to the system manager.
+ */
+static int ownCgroup( char * buffer,size_t size )
+{
+	char line[ 512 ] ;
+
+	int found = 0 ;
+
+	size_t len ;
+
+	FILE * file = fopen( "/proc/self/cgroup","re" ) ;
+
+	if( file == NULL ){
+
+		return 0 ;
+	}
+
+	while( fgets( line,sizeof( line ),file ) != NULL ){
+
+		/*
+		 * the entry of the unified hierarchy is the one with id 0 and no controllers,ie "0::/system.slice/x.service"
+		 */
+		if( strncmp( line,"0::/",4 ) == 0 ){
+
+			len = strlen( line ) ;
+
+			if( line[ len - 1 ] == '\n' ){
+
+				line[ len - 1 ] = '\0' ;
+			}
+
+			/*
+			 * "0::/" is the root of the hierarchy or of the cgroup namespace we run in
+			 */
+			found = snprintf( buffer,size,"%s%s",CGROUP_ROOT,line[ 4 ] ? line + 3 : "" ) < ( int )size ;
+
+			len = strlen( buffer ) ;
+
+			/*
+			 * we are in the leaf we moved ourselves to in an earlier run,the cgroup we own is its parent
+			 */
+			if( found && len > strlen( CGROUP_LEAF ) && stringsAreEqual( buffer + len - strlen( CGROUP_LEAF ),CGROUP_LEAF ) ){
+
+				buffer[ len - strlen( CGROUP_LEAF ) ] = '\0' ;
+			}
+
+			break ;
+		}
+	}
+
+	fclose( file ) ;
+
+	return found ;
+}
+
+static int enableCgroupController( const char * cgroup,const char * controller )
 {
+	char path[ 512 ] ;
+
+	int fd ;
 	int r ;
 
-	uid_t uid = getuid() ;
+	snprintf( path,sizeof( path ),"%s/cgroup.subtree_control",cgroup ) ;
 
-	process_t p = Process( "/bin/pidof","/usr/sbin/synaptic",NULL ) ;
+	fd = open( path,O_WRONLY|O_CLOEXEC ) ;
 
-	ProcessSetOptionUser( p,uid ) ;
-	ProcessStart( p ) ;
+	if( fd == -1 ){
 
-	r = ProcessWaitUntilFinished( &p ) ;
+		return errno ;
+	}
 
-	if( r != 0 ){
+	r = write( fd,controller,strlen( controller ) ) == -1 ? errno : 0 ;
 
-		p = Process( "/bin/pidof","/usr/bin/apt-get",NULL ) ;
-		ProcessSetOptionUser( p,uid ) ;
+	close( fd ) ;
 
-		ProcessStart( p ) ;
+	return r ;
+}
 
-		r = ProcessWaitUntilFinished( &p ) ;
+/*
+ * Controllers can only be enabled in a cgroup that has no processes of its own,the helper service
+ * moves itself to a leaf below its cgroup at start up for this,see enterCgroupLeaf().When other
+ * processes share our cgroup,ie when started from the GUI,the controller is not enabled and
+ * apt-get runs without the limit.
+ */
+static int enableAptCgroupController( const char * parent,const char * controller )
+{
+	int r = enableCgroupController( parent,controller ) ;
+
+	if( r != 0 ){
+
+		printf( "warning: failed to enable \"%s\" in \"%s\": %s\n",controller,parent,strerror( r ) ) ;
 	}
 
 	return r == 0 ;
 }
 
-char * getProcessOutPut( process_t p,int fd,int debug )
+static void createAptCgroup( void )
 {
-	char * e      = NULL ;
-	char * f      = NULL ;
-	char * buffer = NULL ;
+	char parent[ 256 ] ;
+
+	char * path = aptPriority.cgroupPath ;
+
+	int cpu ;
+	int io ;
+	int memory ;
+
+	if( !aptPriority.useCgroup ){
+
+		return ;
+	}
+
+	if( !ownCgroup( parent,sizeof( parent ) ) ){
+
+		printf( "warning: failed to find the cgroup v2 of this process\n" ) ;
+		return ;
+	}
+
+	/*
+	 * controllers must be enabled in the parent for the files of the limits to exist,
+	 * enable them one at a time since not all of them may be available and make nothing
+	 * when none of them is
+	 */
+	cpu    = *aptPriority.cpuWeight && enableAptCgroupController( parent,"+cpu" ) ;
+	io     = *aptPriority.ioWeight && enableAptCgroupController( parent,"+io" ) ;
+	memory = *aptPriority.memoryHigh && enableAptCgroupController( parent,"+memory" ) ;
+
+	if( !cpu && !io && !memory ){
+
+		return ;
+	}
+
+	snprintf( path,sizeof( aptPriority.cgroupPath ),"%s/qt-update-notifier-%d",parent,( int )getpid() ) ;
+
+	if( mkdir( path,0755 ) == -1 && errno != EEXIST ){
+
+		printf( "warning: failed to create cgroup \"%s\": %s\n",path,strerror( errno ) ) ;
+		*path = '\0' ;
+		return ;
+	}
+
+	if( cpu ){
+
+		writeCgroupFile( path,"cpu.weight",aptPriority.cpuWeight ) ;
+	}
+	if( io ){
+
+		writeCgroupFile( path,"io.weight",aptPriority.ioWeight ) ;
+	}
+	if( memory ){
+
+		writeCgroupFile( path,"memory.high",aptPriority.memoryHigh ) ;
+	}
+}
+
+/*
+ * The helper service runs alone in a cgroup delegated to it with "Delegate=yes",it moves itself
+ * to a leaf below it once at start up so that controllers can be enabled in its cgroup and the
+ * workers it forks start in the leaf.Nothing is made when other processes share our cgroup.
+ */
+static int aloneInCgroup( const char * cgroup )
+{
+	char path[ 512 ] ;
+	char line[ 32 ] ;
+
+	int count = 0 ;
+	int self = 0 ;
+
+	FILE * file ;
+
+	snprintf( path,sizeof( path ),"%s/cgroup.procs",cgroup ) ;
+
+	file = fopen( path,"re" ) ;
+
+	if( file == NULL ){
+
+		return 0 ;
+	}
+
+	while( fgets( line,sizeof( line ),file ) != NULL ){
+
+		count++ ;
+
+		if( atoi( line ) == ( int )getpid() ){
+
+			self = 1 ;
+		}
+	}
+
+	fclose( file ) ;
+
+	return count == 1 && self ;
+}
+
+static void enterCgroupLeaf( char * leaf,size_t size )
+{
+	char parent[ 256 ] ;
+
+	*leaf = '\0' ;
+
+	if( !ownCgroup( parent,sizeof( parent ) ) || !aloneInCgroup( parent ) ){
+
+		return ;
+	}
+
+	if( snprintf( leaf,size,"%s%s",parent,CGROUP_LEAF ) >= ( int )size ){
+
+		*leaf = '\0' ;
+		return ;
+	}
+
+	if( mkdir( leaf,0755 ) == -1 && errno != EEXIST ){
+
+		*leaf = '\0' ;
+		return ;
+	}
+
+	if( !writeCgroupFile( leaf,"cgroup.procs","0" ) ){
+
+		rmdir( leaf ) ;
+		*leaf = '\0' ;
+	}
+}
+
+static void leaveCgroupLeaf( const char * leaf )
+{
+	char parent[ 256 ] ;
+
+	if( *leaf && ownCgroup( parent,sizeof( parent ) ) ){
+
+		writeCgroupFile( parent,"cgroup.procs","0" ) ;
+
+		if( rmdir( leaf ) == -1 ){
+
+			printf( "warning: failed to remove cgroup \"%s\": %s\n",leaf,strerror( errno ) ) ;
+		}
+	}
+}
+
+static void removeAptCgroup( void )
+{
+	if( *aptPriority.cgroupPath ){
+
+		/*
+		 * all processes we started have exited by now and an empty cgroup can be removed
+		 */
+		if( rmdir( aptPriority.cgroupPath ) == -1 ){
+
+			printf( "warning: failed to remove cgroup \"%s\": %s\n",aptPriority.cgroupPath,strerror( errno ) ) ;
+		}
+
+		*aptPriority.cgroupPath = '\0' ;
+	}
+}
+
+static void setAptOptions( process_t p )
+{
+	ProcessSetOptionUser( p,0 ) ;
+	ProcessSetOptionPriority( p,aptPriority.nice ) ;
+
+	if( aptPriority.ioClass != 0 ){
+
+		ProcessSetOptionIoPriority( p,aptPriority.ioClass,aptPriority.ioLevel ) ;
+	}
+	if( *aptPriority.cgroupPath ){
+
+		ProcessSetOptionCgroup( p,aptPriority.cgroupPath ) ;
+	}
+}
+
+static int runOperation( int( *operation )( int,int ),int fd,int debug )
+{
+	int r ;
+
+	loadAptPriority() ;
+
+	createAptCgroup() ;
+
+	r = operation( fd,debug ) ;
+
+	removeAptCgroup() ;
+
+	return r ;
+}
+
+/*
+ * When the CLI is started with "--progress",progress of apt-get is reported on stderr
+ * one event per line in the below format:
+ *
+ * progress <stage> <percent> <bytes> <package>
+ *
+ * stage   - one of "update","download","simulate","install" and "clean".
+ * percent - an integer between 0 and 100.
+ * bytes   - number of bytes apt-get said it started fetching so far.
+ * package - name of the package being worked on or "-" if unknown.
+ *
+ * Progress information is read from apt-get through "APT::Status-Fd" and when apt-get
+ * does not support it,download progress is estimated from "Need to get" and "Get:" lines
+ * in its standard output.
+ */
+static int progressFd = -1 ;
+
+/*
+ * set when "progressFd" is a client of the helper service
+ */
+static int progressFdIsSocket = 0 ;
+
+#define LINE_BUFFER_SIZE 1024
+
+typedef struct{
+	char buffer[ LINE_BUFFER_SIZE ] ;
+	size_t size ;
+}lineBuffer_t ;
+
+typedef struct{
+	const char * stage ;
+	const char * lastStage ;
+	int statusPipe[ 2 ] ;
+	char statusFdOption[ 64 ] ;
+	unsigned long long bytes ;
+	unsigned long long totalBytes ;
+	int percent ;
+	int lastPercent ;
+	char package[ 128 ] ;
+	lineBuffer_t out ;
+	lineBuffer_t status ;
+}aptProgress_t ;
+
+static void progressEmit( aptProgress_t * t,const char * stage )
+{
+	char buffer[ 256 ] ;
+
+	int n ;
+
+	if( progressFd == -1 ){
+
+		return ;
+	}
+
+	if( t->percent == t->lastPercent && t->lastStage != NULL && stringsAreEqual( t->lastStage,stage ) ){
+
+		return ;
+	}
+
+	t->lastPercent = t->percent ;
+	t->lastStage   = stage ;
+
+	n = snprintf( buffer,sizeof( buffer ),"progress %s %d %llu %s\n",
+		      stage,t->percent,t->bytes,*t->package ? t->package : "-" ) ;
+
+	if( n <= 0 ){
+
+		return ;
+	}
+
+	n = ( size_t )n < sizeof( buffer ) ? n : ( int )sizeof( buffer ) - 1 ;
+
+	if( progressFdIsSocket ){
+
+		/*
+		 * a client that stopped reading must not stall apt-get,an event that does not fit in the
+		 * socket buffer is dropped.A line this short goes into a unix socket whole or not at all
+		 * and the next event carries the whole state again.
+		 */
+		send( progressFd,buffer,( size_t )n,MSG_DONTWAIT|MSG_NOSIGNAL ) ;
+	}else{
+		write( progressFd,buffer,( size_t )n ) ;
+	}
+}
+
+/*
+ * Starts reporting progress of a stage whose apt-get is not given "APT::Status-Fd",ie a
+ * simulation,and no status pipe is made that would leak into it.
+ */
+static void aptProgressStart( aptProgress_t * t,const char * stage )
+{
+	memset( t,'\0',sizeof( aptProgress_t ) ) ;
+
+	t->stage           = stage ;
+	t->lastPercent     = -1 ;
+	t->statusPipe[ 0 ] = -1 ;
+	t->statusPipe[ 1 ] = -1 ;
+
+	progressEmit( t,stage ) ;
+}
+
+static void aptProgressInit( aptProgress_t * t,const char * stage )
+{
+	memset( t,'\0',sizeof( aptProgress_t ) ) ;
+
+	t->stage       = stage ;
+	t->lastPercent = -1 ;
+
+	/*
+	 * only apt-get is given the write end,other processes we start do not get it,see ProcessSetOptionInheritFd()
+	 */
+	if( pipe2( t->statusPipe,O_CLOEXEC ) == -1 ){
+
+		t->statusPipe[ 0 ] = -1 ;
+		t->statusPipe[ 1 ] = -1 ;
+
+		/*
+		 * apt-get will complain about a bad file descriptor and carry on
+		 */
+		snprintf( t->statusFdOption,sizeof( t->statusFdOption ),"APT::Status-Fd=-1" ) ;
+	}else{
+		snprintf( t->statusFdOption,sizeof( t->statusFdOption ),"APT::Status-Fd=%d",t->statusPipe[ 1 ] ) ;
+	}
+
+	progressEmit( t,stage ) ;
+}
+
+static void aptProgressEnd( aptProgress_t * t,int r )
+{
+	if( t->statusPipe[ 0 ] != -1 ){
+
+		close( t->statusPipe[ 0 ] ) ;
+	}
+	if( t->statusPipe[ 1 ] != -1 ){
+
+		close( t->statusPipe[ 1 ] ) ;
+	}
+
+	if( r == 0 ){
+
+		t->percent = 100 ;
+		*t->package = '\0' ;
+		progressEmit( t,t->stage ) ;
+	}
+}
+
+static unsigned long long parseSize( const char * e )
+{
+	double s = strtod( e,( char ** )&e ) ;
+
+	while( *e == ' ' ){
+
+		e++ ;
+	}
+
+	switch( *e ){
+		case 'k' : return ( unsigned long long )( s * 1000 ) ;
+		case 'M' : return ( unsigned long long )( s * 1000 * 1000 ) ;
+		case 'G' : return ( unsigned long long )( s * 1000 * 1000 * 1000 ) ;
+		default  : return ( unsigned long long )s ;
+	}
+}
+
+static void setPackageName( aptProgress_t * t,const char * e,size_t size )
+{
+	if( size >= sizeof( t->package ) ){
+
+		size = sizeof( t->package ) - 1 ;
+	}
+
+	memcpy( t->package,e,size ) ;
+	t->package[ size ] = '\0' ;
+}
+
+/*
+ * Lines look like "Need to get 12.3MB/45.6MB of archives." and "Get:3 http://host repo pkg version [123kB]"
+ */
+static void aptOutPutLine( aptProgress_t * t,const char * e )
+{
+	const char * f ;
+	const char * g ;
+
+	if( strncmp( e,"Need to get ",12 ) == 0 ){
+
+		t->totalBytes = parseSize( e + 12 ) ;
+
+	}else if( strncmp( e,"Get:",4 ) == 0 ){
+
+		f = strrchr( e,'[' ) ;
+
+		if( f != NULL ){
+
+			t->bytes += parseSize( f + 1 ) ;
+
+			/*
+			 * package name is the second word from the end,before the version
+			 */
+			for( g = f - 1 ; g > e && *g == ' ' ; g-- ){}
+			for( ; g > e && *g != ' ' ; g-- ){}
+			for( f = g ; g > e && *g == ' ' ; g-- ){}
+			for( ; g > e && *( g - 1 ) != ' ' ; g-- ){}
+
+			if( g < f ){
+
+				setPackageName( t,g,( size_t )( f - g ) ) ;
+			}
+		}
+
+		if( t->totalBytes > 0 ){
+
+			t->percent = ( int )( ( t->bytes * 100 ) / t->totalBytes ) ;
+
+			if( t->percent > 99 ){
+
+				t->percent = 99 ;
+			}
+		}
+
+		progressEmit( t,stringsAreEqual( t->stage,"install" ) ? "download" : t->stage ) ;
+	}
+}
+
+/*
+ * Lines look like "dlstatus:1:9.0909:Retrieving file 1 of 11" and "pmstatus:bash:20:Preparing bash"
+ */
+static void aptStatusLine( aptProgress_t * t,const char * e )
+{
+	const char * stage ;
+	const char * f ;
+
+	int install ;
+
+	if( strncmp( e,"dlstatus:",9 ) == 0 ){
+
+		install = 0 ;
+		stage   = stringsAreEqual( t->stage,"install" ) ? "download" : t->stage ;
+
+	}else if( strncmp( e,"pmstatus:",9 ) == 0 ){
+
+		install = 1 ;
+		stage   = "install" ;
+	}else{
+		return ;
+	}
+
+	e = e + 9 ;
+
+	f = strchr( e,':' ) ;
+
+	if( f == NULL ){
+
+		return ;
+	}
+
+	if( install ){
+
+		/*
+		 * dlstatus lines carry an item number here and package names come from "Get:" lines
+		 */
+		setPackageName( t,e,( size_t )( f - e ) ) ;
+	}
+
+	t->percent = ( int )strtod( f + 1,NULL ) ;
+
+	if( t->percent < 0 ){
+
+		t->percent = 0 ;
+
+	}else if( t->percent > 100 ){
+
+		t->percent = 100 ;
+	}
+
+	progressEmit( t,stage ) ;
+}
+
+static void lineBufferAppend( lineBuffer_t * b,aptProgress_t * t,const char * e,size_t size,
+			      void ( *function )( aptProgress_t *,const char * ) )
+{
+	size_t i ;
+
+	for( i = 0 ; i < size ; i++ ){
+
+		if( e[ i ] == '\n' ){
+
+			b->buffer[ b->size ] = '\0' ;
+
+			function( t,b->buffer ) ;
+
+			b->size = 0 ;
+
+		}else if( b->size < LINE_BUFFER_SIZE - 1 ){
+
+			b->buffer[ b->size++ ] = e[ i ] ;
+		}
+	}
+}
+
+static void printProcessOUtPut( process_t p,int fd,int debug,aptProgress_t * t )
+{
+	char buffer[ OUTPUT_CHUNK_SIZE ] ;
+
+	struct pollfd fds[ 2 ] ;
+
+	ssize_t n ;
+
+	int r ;
+
+	if( t->statusPipe[ 1 ] != -1 ){
+
+		/*
+		 * apt-get has its own copy now,close ours to get EOF when it exits
+		 */
+		close( t->statusPipe[ 1 ] ) ;
+		t->statusPipe[ 1 ] = -1 ;
+	}
+
+	fds[ 0 ].fd     = ProcessGetFileDescriptor( p,ProcessStdOut ) ;
+	fds[ 0 ].events = POLLIN ;
+	fds[ 1 ].fd     = t->statusPipe[ 0 ] ;
+	fds[ 1 ].events = POLLIN ;
+
+	while( fds[ 0 ].fd != -1 || fds[ 1 ].fd != -1 ){
+
+		/*
+		 * A process started by a maintainer script,ie a service restarted under sysvinit,may
+		 * keep the status pipe open long after apt-get is gone.Once apt-get exited and its
+		 * standard output reached EOF,what is left in the pipe is read and it is not waited on.
+		 */
+		r = poll( fds,2,fds[ 0 ].fd == -1 ? 500 : -1 ) ;
+
+		if( r == -1 ){
+
+			if( errno == EINTR ){
+
+				continue ;
+			}else{
+				break ;
+			}
+		}
+
+		if( r == 0 ){
+
+			if( ProcessHasExited( p ) ){
+
+				break ;
+			}else{
+				continue ;
+			}
+		}
+
+		if( fds[ 0 ].revents ){
+
+			n = read( fds[ 0 ].fd,buffer,sizeof( buffer ) ) ;
+
+			if( n > 0 ){
+
+				write( fd,buffer,( size_t )n ) ;
+
+				if( debug ){
+
+					fwrite( buffer,1,( size_t )n,stdout ) ;
+				}
+
+				lineBufferAppend( &t->out,t,buffer,( size_t )n,aptOutPutLine ) ;
+
+			}else if( n == 0 || errno != EINTR ){
+
+				fds[ 0 ].fd = -1 ;
+			}
+		}
+
+		if( fds[ 1 ].revents ){
+
+			n = read( fds[ 1 ].fd,buffer,sizeof( buffer ) ) ;
+
+			if( n > 0 ){
+
+				lineBufferAppend( &t->status,t,buffer,( size_t )n,aptStatusLine ) ;
+
+			}else if( n == 0 || errno != EINTR ){
+
+				fds[ 1 ].fd = -1 ;
+			}
+		}
+	}
+}
+
+static int refreshPackageList( int fd,int debug )
+{
+	int r ;
+
+	process_t p ;
+
+	aptProgress_t t ;
+
+	logStage( fd,"entering refreshPackageList" ) ;
+
+	if( userHasPermission() ){
+
+		aptProgressInit( &t,"update" ) ;
+
+		p = Process( "/usr/bin/apt-get","-o",t.statusFdOption,"update",NULL ) ;
+
+		ProcessSetOptionInheritFd( p,t.statusPipe[ 1 ] ) ;
+
+		setAptOptions( p ) ;
+
+		ProcessStart( p ) ;
+
+		printProcessOUtPut( p,fd,debug,&t ) ;
+
+		r = ProcessWaitUntilFinished( &p ) ;
+
+		aptProgressEnd( &t,r ) ;
+	}else{
+		printf( "error: insufficent privileges to perform this operation\n" ) ;
+		r = 1 ;
+	}
+
+	logStage( fd,"leaving refreshPackageList" ) ;
+
+	return r ;
+}
+
+static int aptAndSynapticAreRunning( void )
+{
+	int r ;
+
+	uid_t uid = requestUid ;
+
+	process_t p = Process( "/bin/pidof","/usr/sbin/synaptic",NULL ) ;
+
+	ProcessSetOptionUser( p,uid ) ;
+	ProcessStart( p ) ;
+
+	r = ProcessWaitUntilFinished( &p ) ;
+
+	if( r != 0 ){
+
+		p = Process( "/bin/pidof","/usr/bin/apt-get",NULL ) ;
+		ProcessSetOptionUser( p,uid ) ;
+
+		ProcessStart( p ) ;
+
+		r = ProcessWaitUntilFinished( &p ) ;
+	}
+
+	return r == 0 ;
+}
+
+/*
+ * Output of "apt-get dist-upgrade --simulate" is scanned as it arrives for the markers below.
+ * All markers are looked for in a single pass using an Aho-Corasick automaton and the
+ * automaton state is carried over from one chunk to the next,so a marker that is split
+ * across two reads is still found.
+ */
+#define MATCHER_MAX_STATES 512
+#define OUTPUT_TAIL_SIZE   8192
+
+typedef enum{
+	unmetDependencies = 1 << 0,
+	resolverBreaks    = 1 << 1,
+	packagesKeptBack  = 1 << 2,
+	packagesWillBe    = 1 << 3,
+	noUpdates         = 1 << 4
+}simulateMarker ;
+
+#define UNSAFE_MARKERS ( unmetDependencies | resolverBreaks | packagesKeptBack )
+
+static const struct{
+	const char * text ;
+	simulateMarker marker ;
+}simulateMarkers[] = {
+	{ "The following packages have unmet dependencies",unmetDependencies },
+	{ "E: Error, pkgProblemResolver::Resolve generated breaks, this may be caused by held packages.",resolverBreaks },
+	{ "The following packages have been kept back",packagesKeptBack },
+	{ "\nThe following packages will be",packagesWillBe },
+	{ "0 upgraded, 0 newly installed, 0 removed and 0 not upgraded.",noUpdates }
+} ;
+
+typedef struct{
+	unsigned char c ;
+	short child ;
+	short sibling ;
+	short fail ;
+	int output ;
+}matcherNode ;
+
+typedef struct{
+	matcherNode node[ MATCHER_MAX_STATES ] ;
+	short size ;
+}matcher_t ;
+
+typedef struct{
+	char buffer[ OUTPUT_TAIL_SIZE ] ;
+	size_t position ;
+	int wrapped ;
+}outputTail_t ;
+
+static short matcherChild( const matcher_t * m,short s,unsigned char c )
+{
+	short e = m->node[ s ].child ;
+
+	while( e != -1 ){
+
+		if( m->node[ e ].c == c ){
+
+			return e ;
+		}else{
+			e = m->node[ e ].sibling ;
+		}
+	}
+
+	return -1 ;
+}
+
+static short matcherAddNode( matcher_t * m,short parent,unsigned char c )
+{
+	short e = m->size++ ;
+
+	m->node[ e ].c       = c ;
+	m->node[ e ].child   = -1 ;
+	m->node[ e ].sibling = -1 ;
+	m->node[ e ].fail    = 0 ;
+	m->node[ e ].output  = 0 ;
+
+	if( parent != -1 ){
+
+		m->node[ e ].sibling = m->node[ parent ].child ;
+		m->node[ parent ].child = e ;
+	}
+
+	return e ;
+}
+
+static const matcher_t * simulateMatcher( void )
+{
+	static matcher_t m ;
+
+	short queue[ MATCHER_MAX_STATES ] ;
+	short head = 0 ;
+	short tail = 0 ;
+
+	short s ;
+	short e ;
+	short f ;
+	short n ;
+
+	size_t i ;
+
+	const unsigned char * z ;
+
+	if( m.size > 0 ){
+
+		return &m ;
+	}
+
+	matcherAddNode( &m,-1,0 ) ;
+
+	for( i = 0 ; i < sizeof( simulateMarkers ) / sizeof( simulateMarkers[ 0 ] ) ; i++ ){
+
+		s = 0 ;
+
+		for( z = ( const unsigned char * )simulateMarkers[ i ].text ; *z ; z++ ){
+
+			n = matcherChild( &m,s,*z ) ;
+
+			if( n == -1 ){
+
+				n = matcherAddNode( &m,s,*z ) ;
+			}
+
+			s = n ;
+		}
+
+		m.node[ s ].output |= simulateMarkers[ i ].marker ;
+	}
+
+	/*
+	 * breadth first walk to set up failure links,a node's failure link always points
+	 * to a shallower node and hence its output is already complete when we get to it.
+	 */
+	for( e = m.node[ 0 ].child ; e != -1 ; e = m.node[ e ].sibling ){
+
+		queue[ tail++ ] = e ;
+	}
+
+	while( head < tail ){
+
+		s = queue[ head++ ] ;
+
+		for( e = m.node[ s ].child ; e != -1 ; e = m.node[ e ].sibling ){
+
+			queue[ tail++ ] = e ;
+
+			f = m.node[ s ].fail ;
+
+			while( f != 0 && matcherChild( &m,f,m.node[ e ].c ) == -1 ){
+
+				f = m.node[ f ].fail ;
+			}
+
+			n = matcherChild( &m,f,m.node[ e ].c ) ;
+
+			m.node[ e ].fail    = n == -1 ? 0 : n ;
+			m.node[ e ].output |= m.node[ m.node[ e ].fail ].output ;
+		}
+	}
+
+	return &m ;
+}
+
+static int matcherFeed( const matcher_t * m,short * state,const char * e,size_t size )
+{
+	int found = 0 ;
+
+	short s = *state ;
+	short n ;
+
+	size_t i ;
+
+	unsigned char c ;
+
+	for( i = 0 ; i < size ; i++ ){
+
+		c = ( unsigned char )e[ i ] ;
+
+		while( s != 0 && matcherChild( m,s,c ) == -1 ){
+
+			s = m->node[ s ].fail ;
+		}
+
+		n = matcherChild( m,s,c ) ;
+
+		s = n == -1 ? 0 : n ;
+
+		found |= m->node[ s ].output ;
+	}
+
+	*state = s ;
+
+	return found ;
+}
+
+static void outputTailAppend( outputTail_t * t,const char * e,size_t size )
+{
+	size_t s ;
+
+	if( size >= OUTPUT_TAIL_SIZE ){
+
+		e    = e + size - OUTPUT_TAIL_SIZE ;
+		size = OUTPUT_TAIL_SIZE ;
+	}
+
+	s = OUTPUT_TAIL_SIZE - t->position ;
+
+	if( size < s ){
+
+		memcpy( t->buffer + t->position,e,size ) ;
+		t->position += size ;
+	}else{
+		memcpy( t->buffer + t->position,e,s ) ;
+		memcpy( t->buffer,e + s,size - s ) ;
+		t->position = size - s ;
+		t->wrapped  = 1 ;
+	}
+}
+
+static void outputTailPrint( const outputTail_t * t )
+{
+	if( t->wrapped ){
+
+		fwrite( t->buffer + t->position,1,OUTPUT_TAIL_SIZE - t->position,stdout ) ;
+	}
+
+	fwrite( t->buffer,1,t->position,stdout ) ;
+	printf( "\n" ) ;
+}
+
+/*
+ * return values:
+ * 0 - it is safe to update.
+ * 1 - it is not safe to update.
+ * 2 - there are no updates.
+ */
+static int simulateUpdate( int fd,int debug )
+{
+	const matcher_t * m = simulateMatcher() ;
+
+	static outputTail_t tail ;
+
+	char buffer[ OUTPUT_CHUNK_SIZE ] ;
+
+	size_t received = 0 ;
+
+	ssize_t n ;
+
+	short state = 0 ;
+
+	int found = 0 ;
+
+	int r ;
+	int st ;
+
+	aptProgress_t t ;
+
+	process_t p = Process( "/usr/bin/apt-get","dist-upgrade","--simulate",NULL ) ;
+
+	tail.position = 0 ;
+	tail.wrapped  = 0 ;
+
+	aptProgressStart( &t,"simulate" ) ;
+
+	setAptOptions( p ) ;
+
+	ProcessStart( p ) ;
+
+	while( 1 ){
+
+		n = ProcessGetOutPut_1( p,buffer,sizeof( buffer ),ProcessStdOut ) ;
+
+		if( n == -1 && errno == EINTR ){
+
+			continue ;
+		}
+
+		if( n <= 0 ){
+
+			break ;
+		}
+
+		received += ( size_t )n ;
+
+		write( fd,buffer,( size_t )n ) ;
+
+		if( debug ){
+
+			fwrite( buffer,1,( size_t )n,stdout ) ;
+		}
+
+		outputTailAppend( &tail,buffer,( size_t )n ) ;
+
+		found |= matcherFeed( m,&state,buffer,( size_t )n ) ;
+
+		if( found & UNSAFE_MARKERS ){
+
+			/*
+			 * No need to wait for the simulation to finish,we already know the answer.
+			 */
+			logStage( fd,"unsafe marker found,aborting apt-get dist-upgrade --simulate" ) ;
+
+			ProcessTerminate( p ) ;
+
+			break ;
+		}
+	}
 
-	size_t buffer_size = 0 ;
-	size_t output_size = 0 ;
+	st = ProcessWaitUntilFinished( &p ) ;
 
-	while( 1 ){
+	if( received == 0 ){
 
-		output_size = ProcessGetOutPut( p,&e,ProcessStdOut ) ;
+		printf( "IT IS NOT SAFE TO UPDATE,apt-get gave no output\n" ) ;
+		r = 1 ;
 
-		if( output_size > 0 ){
+	}else if( found & UNSAFE_MARKERS ){
 
-			write( fd,e,output_size ) ;
+		if( !debug ){
 
-			f = realloc( buffer,buffer_size + output_size + 1 ) ;
+			outputTailPrint( &tail ) ;
+		}
 
-			if( f != NULL ){
+		r = 1 ;
 
-				buffer = f ;
+	}else if( found & packagesWillBe ){
 
-				strcpy( buffer + buffer_size,e ) ;
+		r = 0 ;
 
-				buffer_size += output_size ;
+	}else if( found & noUpdates ){
 
-				printOUtPut( e,debug ) ;
-				free( e ) ;
-			}else{
-				free( e ) ;
-				break ;
-			}
-		}else{
-			break ;
-		}
+		r = 2 ;
+	}else{
+		r = 1 ;
 	}
 
-	return buffer ;
+	aptProgressEnd( &t,st ) ;
+
+	return r ;
 }
 
 static int autoUpdate( int fd,int debug )
@@ -281,7 +1511,7 @@ static int autoUpdate( int fd,int debug )
 
 	int r ;
 
-	char * buffer ;
+	aptProgress_t t ;
 
 	logStage( fd,"entering autoUpdate" ) ;
 
@@ -310,27 +1540,7 @@ static int autoUpdate( int fd,int debug )
 			/*
 			 * check if its safe to update
 			 */
-
-			p = Process( "/usr/bin/apt-get","dist-upgrade","--simulate",NULL ) ;
-
-			ProcessSetOptionUser( p,0 ) ;
-			ProcessSetOptionPriority( p,PRIORITY ) ;
-
-			ProcessStart( p ) ;
-
-			buffer = getProcessOutPut( p,fd,debug ) ;
-
-			ProcessWaitUntilFinished( &p ) ;
-
-			if( buffer ){
-
-				r = itIsSafeToUpdate( buffer,debug ) ;
-
-				free( buffer ) ;
-			}else{
-				printf( "IT IS NOT SAFE TO UPDATE,apt-get gave no output\n" ) ;
-				r = 1 ;
-			}
+			r = simulateUpdate( fd,debug ) ;
 
 			if( r == 0 ){
 
@@ -340,17 +1550,22 @@ static int autoUpdate( int fd,int debug )
 				 */
 				printf( "updates found\n" ) ;
 
-				p = Process( "/usr/bin/apt-get","dist-upgrade","--assume-yes",NULL ) ;
+				aptProgressInit( &t,"install" ) ;
 
-				ProcessSetOptionUser( p,0 ) ;
-				ProcessSetOptionPriority( p,PRIORITY ) ;
+				p = Process( "/usr/bin/apt-get","-o",t.statusFdOption,"dist-upgrade","--assume-yes",NULL ) ;
+
+				ProcessSetOptionInheritFd( p,t.statusPipe[ 1 ] ) ;
+
+				setAptOptions( p ) ;
 
 				ProcessStart( p ) ;
 
-				printProcessOUtPut( p,fd,debug ) ;
+				printProcessOUtPut( p,fd,debug,&t ) ;
 
 				r = ProcessWaitUntilFinished( &p ) ;
 
+				aptProgressEnd( &t,r ) ;
+
 				logStage( fd,"done running apt-get dist-upgrade --assume-yes" ) ;
 
 				if( r != 0 ){
@@ -363,14 +1578,15 @@ static int autoUpdate( int fd,int debug )
 					/*
 					 * clear cache
 					 */
+					aptProgressInit( &t,"clean" ) ;
+
 					p = Process( "/usr/bin/apt-get","clean",NULL ) ;
 
-					ProcessSetOptionUser( p,0 ) ;
-					ProcessSetOptionPriority( p,PRIORITY ) ;
+					setAptOptions( p ) ;
 
 					ProcessStart( p ) ;
 
-					ProcessWaitUntilFinished( &p ) ;
+					aptProgressEnd( &t,ProcessWaitUntilFinished( &p ) ) ;
 
 					logStage( fd,"done running apt-get clean" ) ;
 				}
@@ -396,6 +1612,8 @@ static int downloadPackages( int fd,int debug )
 
 	int r ;
 
+	aptProgress_t t ;
+
 	logStage( fd,"entering downloadPackages" ) ;
 
 	if( userHasPermission() ){
@@ -404,16 +1622,21 @@ static int downloadPackages( int fd,int debug )
 
 		if( r == 0 ){
 
-			p = Process( "/usr/bin/apt-get","dist-upgrade","--download-only","--assume-yes",NULL ) ;
+			aptProgressInit( &t,"download" ) ;
+
+			p = Process( "/usr/bin/apt-get","-o",t.statusFdOption,"dist-upgrade","--download-only","--assume-yes",NULL ) ;
 
-			ProcessSetOptionUser( p,0 ) ;
-			ProcessSetOptionPriority( p,PRIORITY ) ;
+			ProcessSetOptionInheritFd( p,t.statusPipe[ 1 ] ) ;
+
+			setAptOptions( p ) ;
 
 			ProcessStart( p ) ;
 
-			printProcessOUtPut( p,fd,debug ) ;
+			printProcessOUtPut( p,fd,debug,&t ) ;
 
 			r = ProcessWaitUntilFinished( &p ) ;
+
+			aptProgressEnd( &t,r ) ;
 		}
 	}else{
 		logStage( fd,"error: insufficent privileges to perform this operation\n" ) ;
@@ -433,7 +1656,7 @@ static int startSynaptic( const char * e )
 
 		ProcessSetOptionUser( p,0 ) ;
 	}else{
-		ProcessSetOptionUser( p,getuid() ) ;
+		ProcessSetOptionUser( p,requestUid ) ;
 	}
 
 	ProcessStart( p ) ;
@@ -441,6 +1664,396 @@ static int startSynaptic( const char * e )
 	return ProcessWaitUntilFinished( &p ) ;
 }
 
+/*
+ * Helper service mode.
+ *
+ * When started by root with "--daemon",the CLI listens on a unix socket and performs
+ * package operations on behalf of members of the "qtupdatenotifier" group.Peers are identified
+ * with SO_PEERCRED and requests are served one at a time,so package operations from different
+ * users never overlap.
+ *
+ * A request is a single line with "--auto-update" or "--download-packages".Once it is accepted
+ * "started" is sent back,then progress using the format documented above "progressFd" and the
+ * last line is "exit <code>".While the request is served a line with "alive" is sent every
+ * KEEPALIVE_INTERVAL seconds so that a client can tell a long quiet step from a hung service.
+ *
+ * A request is served in a child process while the service keeps accepting connections,one
+ * that comes in while another request is served is answered right away with "exit 13".
+ */
+#define REQUEST_TIMEOUT 5
+#define KEEPALIVE_INTERVAL 10
+#define SERVICE_BUSY 13
+
+/*
+ * The log is in the home directory of the user and the user controls what is at its path,it is
+ * therefore opened with the uid,gid and groups of the user,a symbolic link is not followed and
+ * anything but a regular file owned by the user is refused.
+ */
+static int userLog( userEntry_t * e )
+{
+	struct stat st ;
+
+	gid_t groups[ USER_GROUPS_MAX ] ;
+
+	int count ;
+	int fd ;
+
+	if( e->logFd != -1 ){
+
+		if( lstat( e->logPath,&st ) == 0 && st.st_ino == e->logInode ){
+
+			if( ftruncate( e->logFd,0 ) == 0 && lseek( e->logFd,0,SEEK_SET ) == 0 ){
+
+				return e->logFd ;
+			}
+		}
+
+		close( e->logFd ) ;
+		e->logFd = -1 ;
+	}
+
+	count = getgroups( USER_GROUPS_MAX,groups ) ;
+
+	if( count == -1 ){
+		return -1 ;
+	}
+
+	if( setgroups( ( size_t )e->groupCount,e->groups ) == -1 ||
+	    setegid( e->gid ) == -1 ||
+	    seteuid( e->uid ) == -1 ){
+
+		fd = -1 ;
+	}else{
+		fd = open( e->logPath,O_CREAT|O_TRUNC|O_WRONLY|O_CLOEXEC|O_NOFOLLOW,S_IRUSR|S_IWUSR ) ;
+
+		if( fd != -1 ){
+
+			if( fstat( fd,&st ) == 0 && S_ISREG( st.st_mode ) && st.st_uid == e->uid ){
+
+				fchmod( fd,S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH ) ;
+			}else{
+				close( fd ) ;
+				fd = -1 ;
+			}
+		}
+	}
+
+	if( seteuid( 0 ) == -1 || setegid( 0 ) == -1 || setgroups( ( size_t )count,groups ) == -1 ){
+
+		if( fd != -1 ){
+			close( fd ) ;
+		}
+
+		return -1 ;
+	}
+
+	if( fd != -1 ){
+
+		e->logFd    = fd ;
+		e->logInode = st.st_ino ;
+	}
+
+	return fd ;
+}
+
+static int readRequest( int s,char * buffer,size_t size )
+{
+	size_t i = 0 ;
+
+	ssize_t n ;
+
+	while( i < size - 1 ){
+
+		n = read( s,buffer + i,1 ) ;
+
+		if( n == -1 && errno == EINTR ){
+
+			continue ;
+		}
+
+		if( n <= 0 ){
+
+			return 0 ;
+		}
+
+		if( buffer[ i ] == '\n' ){
+
+			break ;
+		}else{
+			i++ ;
+		}
+	}
+
+	buffer[ i ] = '\0' ;
+
+	return 1 ;
+}
+
+static void serveRequest( int s )
+{
+	struct ucred cred ;
+
+	struct timeval tv ;
+
+	socklen_t len = sizeof( cred ) ;
+
+	userEntry_t * user ;
+
+	char request[ 256 ] ;
+	char reply[ 64 ] ;
+
+	int fd ;
+	int st ;
+	int n ;
+
+	if( getsockopt( s,SOL_SOCKET,SO_PEERCRED,&cred,&len ) == -1 ){
+
+		return ;
+	}
+
+	/*
+	 * requests are served one at a time,do not let a client that never sends anything block others
+	 */
+	tv.tv_sec  = REQUEST_TIMEOUT ;
+	tv.tv_usec = 0 ;
+
+	setsockopt( s,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof( tv ) ) ;
+
+	/*
+	 * and do not let a client that stopped reading block us on the reply
+	 */
+	setsockopt( s,SOL_SOCKET,SO_SNDTIMEO,&tv,sizeof( tv ) ) ;
+
+	if( !readRequest( s,request,sizeof( request ) ) ){
+
+		return ;
+	}
+
+	requestUid = cred.uid ;
+
+	user = lookupUser( cred.uid ) ;
+
+	if( user == NULL || !user->hasPermission ){
+
+		printf( "error: uid %d has insufficent privileges to perform this operation\n",( int )cred.uid ) ;
+
+		st = 1 ;
+	}else{
+		fd = userLog( user ) ;
+
+		if( fd == -1 ){
+
+			st = 11 ;
+		}else{
+			send( s,"started\n",8,MSG_NOSIGNAL ) ;
+
+			progressFd = s ;
+			progressFdIsSocket = 1 ;
+
+			if( stringsAreEqual( request,"--auto-update" ) ){
+
+				st = runOperation( autoUpdate,fd,0 ) ;
+
+			}else if( stringsAreEqual( request,"--download-packages" ) ){
+
+				st = runOperation( downloadPackages,fd,0 ) ;
+			}else{
+				printf( "error: unrecognized or invalid request\n" ) ;
+				st = 1 ;
+			}
+
+			progressFd = -1 ;
+			progressFdIsSocket = 0 ;
+		}
+	}
+
+	n = snprintf( reply,sizeof( reply ),"exit %d\n",st ) ;
+
+	write( s,reply,( size_t )n ) ;
+
+	fflush( stdout ) ;
+}
+
+/*
+ * Only there to wake up poll() when a request is served,the child is reaped in the loop below
+ */
+static void workerExited( int e )
+{
+	( void )e ;
+}
+
+static int runHelperService( const char * path )
+{
+	struct sockaddr_un addr ;
+
+	struct pollfd listener ;
+
+	char reply[ 64 ] ;
+	char cgroupLeaf[ 512 ] ;
+
+	pid_t worker = -1 ;
+
+	int workerFd = -1 ;
+	int s ;
+	int c ;
+	int r ;
+	int n ;
+
+	if( getuid() != 0 ){
+
+		printf( "error: helper service can only be started by root\n" ) ;
+		return 1 ;
+	}
+
+	if( strlen( path ) >= sizeof( addr.sun_path ) ){
+
+		printf( "error: socket path is too long\n" ) ;
+		return 1 ;
+	}
+
+	s = socket( AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0 ) ;
+
+	if( s == -1 ){
+
+		printf( "error: failed to create a socket\n" ) ;
+		return 1 ;
+	}
+
+	memset( &addr,'\0',sizeof( addr ) ) ;
+
+	addr.sun_family = AF_UNIX ;
+
+	memcpy( addr.sun_path,path,strlen( path ) + 1 ) ;
+
+	unlink( path ) ;
+
+	if( bind( s,( struct sockaddr * )&addr,sizeof( addr ) ) == -1 || listen( s,16 ) == -1 ){
+
+		printf( "error: failed to listen on \"%s\"\n",path ) ;
+		close( s ) ;
+		return 1 ;
+	}
+
+	/*
+	 * anybody can connect,permission is checked per request using SO_PEERCRED
+	 */
+	chmod( path,S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH ) ;
+
+	/*
+	 * a client that goes away in the middle of an operation must not kill us
+	 */
+	signal( SIGPIPE,SIG_IGN ) ;
+
+	signal( SIGCHLD,workerExited ) ;
+
+	setDefaultLanguageToEnglish() ;
+
+	enterCgroupLeaf( cgroupLeaf,sizeof( cgroupLeaf ) ) ;
+
+	printf( "listening on \"%s\"\n",path ) ;
+	fflush( stdout ) ;
+
+	while( 1 ){
+
+		if( worker != -1 && waitpid( worker,NULL,WNOHANG ) == worker ){
+
+			close( workerFd ) ;
+
+			worker   = -1 ;
+			workerFd = -1 ;
+		}
+
+		listener.fd      = s ;
+		listener.events  = POLLIN ;
+		listener.revents = 0 ;
+
+		r = poll( &listener,1,worker == -1 ? -1 : KEEPALIVE_INTERVAL * 1000 ) ;
+
+		if( r == -1 ){
+
+			if( errno == EINTR ){
+
+				continue ;
+			}else{
+				break ;
+			}
+		}
+
+		if( r == 0 ){
+
+			/*
+			 * a line this short goes into a unix socket whole or not at all,see progressEmit()
+			 */
+			send( workerFd,"alive\n",6,MSG_DONTWAIT|MSG_NOSIGNAL ) ;
+
+			continue ;
+		}
+
+		c = accept4( s,NULL,NULL,SOCK_CLOEXEC ) ;
+
+		if( c == -1 ){
+
+			if( errno == EINTR || errno == ECONNABORTED ){
+
+				continue ;
+			}else{
+				break ;
+			}
+		}
+
+		if( worker != -1 && waitpid( worker,NULL,WNOHANG ) == 0 ){
+
+			n = snprintf( reply,sizeof( reply ),"exit %d\n",SERVICE_BUSY ) ;
+
+			send( c,reply,( size_t )n,MSG_DONTWAIT|MSG_NOSIGNAL ) ;
+
+			close( c ) ;
+
+			continue ;
+		}
+
+		if( workerFd != -1 ){
+
+			close( workerFd ) ;
+		}
+
+		worker   = fork() ;
+		workerFd = c ;
+
+		if( worker == 0 ){
+
+			signal( SIGCHLD,SIG_DFL ) ;
+
+			close( s ) ;
+
+			serveRequest( c ) ;
+
+			close( c ) ;
+
+			_exit( 0 ) ;
+
+		}else if( worker == -1 ){
+
+			close( c ) ;
+
+			workerFd = -1 ;
+		}
+	}
+
+	close( s ) ;
+	unlink( path ) ;
+
+	if( worker != -1 ){
+
+		waitpid( worker,NULL,0 ) ;
+		close( workerFd ) ;
+	}
+
+	leaveCgroupLeaf( cgroupLeaf ) ;
+
+	return 1 ;
+}
+
 static int printOptions( void )
 {
 	const char * options = "\
@@ -453,10 +2066,15 @@ argument list:\n\
 	--download-packages	calls \"apt-get update\" followed by \"apt-get --dist-upgrade --download-only --assume-yes\"\n\
 	--start-synaptic	calls \"kdesu /usr/sbin/synaptic\"\n\
 	--start-synaptic --update-at-startup	calls \"kdesu /usr/sbin/synaptic --update-at-startup\"\n\
+	--progress	this option can be added after \"--auto-update\" or \"--download-packages\" to print\n\
+			progress events on stderr in the format \"progress <stage> <percent> <bytes> <package>\"\n\
+	--daemon [path]	run as a helper service listening on a unix socket at \"path\",defaults to\n\
+			\""QT_UPDATE_NOTIFIER_HELPER_SOCKET"\",this option can only be used by root\n\
 	--debug      	this option can be added as the last option to print program output on the terminal.\n\
 			The same printed information will also be  in ~/.config/qt-update-notifier/backEnd.log\n\
 NOTE:\n\
-	\"kdesu\" will be used in kde session and gksu will be used in any other session\n" ;
+	\"kdesu\" will be used in kde session and gksu will be used in any other session\n\
+	nice value,I/O scheduling class and cgroup v2 limits of apt-get can be set in \""CONFIG_FILE"\"\n" ;
 
 	printf( "%s",options ) ;
 	return 0 ;
@@ -475,28 +2093,39 @@ int main( int argc,char * argv[] )
 
 	int fd ;
 	int st ;
+	int i ;
 
 	int debug ;
 
-	char logPath[ 1024 ] ;
+	userEntry_t * user ;
 
-	struct passwd * pass = getpwuid( getuid() ) ;
+	requestUid = getuid() ;
 
-	if( pass == NULL ){
+	user = lookupUser( requestUid ) ;
+
+	if( user == NULL ){
 		return 10 ;
 	}
 
-	snprintf( logPath,1024,"/home/%s/.config/qt-update-notifier/backEnd.log",pass->pw_name ) ;
-
 	if( argc < 2 ){
 		return printOptions() ;
 	}
 
+	if( stringsAreEqual( *( argv + 1 ),"--daemon" ) ){
+
+		if( argc > 2 ){
+
+			return runHelperService( *( argv + 2 ) ) ;
+		}else{
+			return runHelperService( QT_UPDATE_NOTIFIER_HELPER_SOCKET ) ;
+		}
+	}
+
 	if( seteuid( getuid() ) == -1 ){
 		return 12 ;
 	}
 
-	fd = open( logPath,O_CREAT|O_TRUNC|O_WRONLY,S_IRUSR|S_IWUSR ) ;
+	fd = open( user->logPath,O_CREAT|O_TRUNC|O_WRONLY,S_IRUSR|S_IWUSR ) ;
 
 	if( seteuid( 0 ) == -1 ){
 		close( fd ) ;
@@ -521,6 +2150,14 @@ int main( int argc,char * argv[] )
 		}
 	}
 
+	for( i = 2 ; i < argc ; i++ ){
+
+		if( stringsAreEqual( *( argv + i ),"--progress" ) ){
+
+			progressFd = 2 ;
+		}
+	}
+
 	if( _help( e ) ){
 
 		st = printOptions() ;
@@ -544,11 +2181,11 @@ int main( int argc,char * argv[] )
 		}else{
 			if( stringsAreEqual( e,"--auto-update" ) ){
 
-				st = autoUpdate( fd,debug ) ;
+				st = runOperation( autoUpdate,fd,debug ) ;
 
 			}else if( stringsAreEqual( e,"--download-packages" ) ){
 
-				st = downloadPackages( fd,debug ) ;
+				st = runOperation( downloadPackages,fd,debug ) ;
 
 			}else{
 				printf( "error: unrecognized or invalid option\n" ) ;
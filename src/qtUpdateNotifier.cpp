@@ -21,33 +21,13 @@
 #include "twitter.h"
 
 #include <QCoreApplication>
-#include <QJsonDocument>
 
 #include <utility>
+#include <algorithm>
 
 #include <iostream>
 
-struct jsonResult
-{
-	bool ok ;
-	QList<QVariant> value ;
-} ;
-
-jsonResult _parseJSON( const QByteArray& e )
-{
-	QJsonParseError error ;
-
-	auto r = QJsonDocument::fromJson( e,&error ) ;
-
-	if( error.error == QJsonParseError::NoError ){
-
-		return { true,r.toVariant().toList() } ;
-	}else{
-		return { false,QList< QVariant >() } ;
-	}
-}
-
-qtUpdateNotifier::qtUpdateNotifier( bool e ) : m_autoStart( e )
+qtUpdateNotifier::qtUpdateNotifier( bool e ) : m_autoStart( e ),m_feed( m_manager )
 {
 	this->setupTranslationText() ;
 	m_twitter.translate() ;
@@ -73,6 +53,7 @@ void qtUpdateNotifier::aptGetLogWindow()
 	auto w = new logWindow( tr( "Apt-get upgrade output log window" ) )  ;
 	connect( this,SIGNAL( updateLogWindow() ),w,SLOT( updateLogWindow_1() ) ) ;
 	connect( this,SIGNAL( configOptionsChanged_1() ),w,SLOT( updateLogWindow_1() ) ) ;
+	connect( this,SIGNAL( aptGetProgress( QString ) ),w,SLOT( updateProgress( QString ) ) ) ;
 	w->showAptGetWindow() ;
 }
 
@@ -87,9 +68,9 @@ void qtUpdateNotifier::changeIcon( QString icon )
 	m_statusicon.setAttentionIconByName( icon ) ;
 }
 
-void qtUpdateNotifier::startUpdater()
+Task::coroutine qtUpdateNotifier::startUpdater()
 {
-	if( utility::startSynaptic().await() ){
+	if( co_await utility::startSynaptic() ){
 
 		this->logActivity( tr( "Synaptic exited with errors" ) ) ;
 	}
@@ -97,77 +78,21 @@ void qtUpdateNotifier::startUpdater()
 	this->doneUpdating() ;
 }
 
-QString qtUpdateNotifier::getLastTwitterUpdate()
-{
-	return m_lastTwitterUpdate ;
-}
-
-void qtUpdateNotifier::setLastTwitterUpdate( const QString& e )
+void qtUpdateNotifier::announcement( QString e )
 {
-	m_lastTwitterUpdate = e ;
-	settings::setLastTwitterUpdate( e ) ;
+	this->showToolTip( "qt-update-notifier-important-info",tr( "No updates found" ) ) ;
+	this->logActivity_1( e ) ;
+	this->showIconOnImportantInfo() ;
 }
 
-QString qtUpdateNotifier::networResponse( QNetworkReply& s )
+/*
+ * A failed poll shows what was fetched before.
+ */
+void qtUpdateNotifier::announcementsUpdated()
 {
-	auto l = s.rawHeaderList() ;
-
-	QString e ;
-
-	if( m_debug ){
-
-		for( const auto& it : l ){
-
-			e += it + ":" + s.rawHeader( it ) + "\n" ;
-		}
-	}
-
-	if( s.rawHeader( "status" ) != "200 OK" ){
-
-		return e ;
-	}
-
-	auto data = s.readAll() ;
+	if( m_twitter.isVisible() ){
 
-	if( data.isEmpty() ){
-
-		return e ;
-	}
-
-	auto j = _parseJSON( data ) ;
-
-	if( j.ok ){
-
-		const auto& l = j.value ;
-
-		auto s = this->getLastTwitterUpdate().toULongLong() ;
-
-		this->setLastTwitterUpdate( l.first().toMap()[ "id_str" ].toString() ) ;
-
-		for( const auto& it : l ){
-
-			auto map  = it.toMap() ;
-			auto z    = map[ "id_str" ].toString().toULongLong() ;
-			auto text = map[ "text" ].toString() ;
-
-			if( z > s ){
-
-				if( text.contains( "ANNOUNCEMENT" ) ){
-
-					this->showToolTip( "qt-update-notifier-important-info",tr( "No updates found" ) ) ;
-					this->logActivity_1( text ) ;
-					this->showIconOnImportantInfo() ;
-				}
-			}
-
-			e += "\n" + map[ "created_at" ].toString() + ":\n" + text + "\n" ;
-		}
-
-		e += "\nhttps://twitter.com/iluvpclinuxos" ;
-
-		return e ;
-	}else{
-		return e ;
+		m_twitter.msg( m_feed.text() ) ;
 	}
 }
 
@@ -175,23 +100,7 @@ void qtUpdateNotifier::checkTwitter()
 {
 	m_twitter.ShowUI( tr( "connecting ..." ) ) ;
 
-	QUrl url( m_url ) ;
-
-	QNetworkRequest s( url ) ;
-
-	s.setRawHeader( "Host","api.twitter.com" ) ;
-	s.setRawHeader( "User-Agent","qt-update-notifier" ) ;
-	s.setRawHeader( "Authorization",m_token ) ;
-	s.setRawHeader( "Accept-Encoding","text/plain" ) ;
-
-	m_manager.get( 30,s,[ this ]( QNetworkReply& e ){
-
-		m_twitter.msg( this->networResponse( e ) ) ;
-
-	},[ this ](){
-
-		m_twitter.msg( QString() ) ;
-	} ) ;
+	m_feed.pollNow() ;
 }
 
 void qtUpdateNotifier::showIconOnImportantInfo()
@@ -230,7 +139,7 @@ void qtUpdateNotifier::openConfigureDialog()
 	auto cfg = new configureDialog() ;
 
 	connect( cfg,SIGNAL( toggleAutoStart( bool ) ),this,SLOT( toggleAutoStart( bool ) ) ) ;
-	connect( cfg,SIGNAL( setUpdateInterval( int ) ),this,SLOT( setUpdateInterval( int ) ) ) ;
+	connect( cfg,SIGNAL( setUpdateInterval( qint64 ) ),this,SLOT( setUpdateInterval( qint64 ) ) ) ;
 	connect( cfg,SIGNAL( configOptionsChanged() ),this,SLOT( configOptionsChanged() ) ) ;
 	connect( cfg,SIGNAL( autoReshreshSynaptic( bool ) ),this,SLOT( autoRefreshSynaptic( bool ) ) ) ;
 
@@ -267,7 +176,14 @@ void qtUpdateNotifier::buildGUI()
 {
         connect( &m_timer,SIGNAL( timeout() ),this,SLOT( automaticCheckForUpdates() ) ) ;
 
+        m_deferTimer.setSingleShot( true ) ;
+
+        connect( &m_deferTimer,SIGNAL( timeout() ),this,SLOT( checkForUpdatesWhenIdle() ) ) ;
+
         m_threadIsRunning = false ;
+        m_checkingIfIdle  = false ;
+        m_deferredSince   = 0 ;
+        m_deferDelay      = 0 ;
 
 	m_statusicon.setStatus( statusicon::ItemStatus::Passive ) ;
 	m_statusicon.setCategory( statusicon::ItemCategory::ApplicationStatus ) ;
@@ -276,20 +192,25 @@ void qtUpdateNotifier::buildGUI()
 
         this->changeIcon( m_defaulticon ) ;
 
-        auto q = settings::delayTimeBeforeUpdateCheck( settings::delayTimeBeforeUpdateCheck() ) ;
+        auto q = settings::delayTimeBeforeUpdateCheck( static_cast< int >( m_startUpDelay ) ) ;
 	auto z = tr( "Waiting for %1 minutes before checking for updates" ).arg( q ) ;
         auto a = m_defaulticon ;
         auto b = tr( "Status" ) ;
 
         this->showToolTip( a,b,z ) ;
 
-        m_url   = settings::url() ;
-        m_token = settings::token() ;
-
         m_showIconOnImportantInfo = settings::showIconOnImportantInfo() ;
         m_networkConnectivityChecker = settings::networkConnectivityChecker() ;
 
-        m_lastTwitterUpdate = settings::getLastTwitterUpdate() ;
+        m_manager.setCacheDirectory( settings::configPath() + "/cache" ) ;
+        m_manager.setRetryPolicy( settings::networkRetryAttempts(),500,settings::networkRetryMaxDelay() ) ;
+        m_manager.setCircuitBreaker( 3,settings::networkCircuitBreakerCoolDown() ) ;
+
+        connect( &m_feed,SIGNAL( announcement( QString ) ),this,SLOT( announcement( QString ) ) ) ;
+        connect( &m_feed,SIGNAL( updated() ),this,SLOT( announcementsUpdated() ) ) ;
+        connect( &m_feed,SIGNAL( failed() ),this,SLOT( announcementsUpdated() ) ) ;
+
+        m_feed.start() ;
 }
 
 void qtUpdateNotifier::run()
@@ -300,6 +221,14 @@ void qtUpdateNotifier::run()
         }else{
 		m_sleepDuration  = settings::updateCheckInterval() ;
 
+		/*
+		 * Machines that are started together would otherwise all check at the same time,
+		 * the splay gives each one its own place in a window after the start up delay
+		 */
+		m_startUpDelay   = settings::delayTimeBeforeUpdateCheck() +
+				   utility::splay( settings::updateCheckSplay() ) +
+				   utility::jitter( settings::updateCheckJitter() ) ;
+
                 this->buildGUI() ;
 
                 this->logActivity( tr( "Qt-update-notifier started" ) ) ;
@@ -334,7 +263,7 @@ void qtUpdateNotifier::run()
 
 		m_statusicon.addQuitAction() ;
 
-		auto s = settings::delayTimeBeforeUpdateCheck() ;
+		auto s = static_cast< int >( m_startUpDelay ) ;
 
 		if( s == 0 ){
 
@@ -363,9 +292,6 @@ void qtUpdateNotifier::checkForUpdatesOnStartUp()
 {
 	if( settings::firstTimeRun() ){
 
-		m_timer.stop() ;
-		m_timer.start( static_cast< int >( m_sleepDuration ) ) ;
-
 		m_nextScheduledUpdateTime = this->getCurrentTime() ;
 
 		this->automaticCheckForUpdates() ;
@@ -374,89 +300,42 @@ void qtUpdateNotifier::checkForUpdatesOnStartUp()
 
 		auto scheduledTime = settings::nextScheduledUpdateTime() ;
 
-		qint64 interval = currentTime - scheduledTime ;
-
-		if( interval < 0 ){
+		m_nextScheduledUpdateTime = scheduledTime ;
 
-			interval = -interval ;
+		if( scheduledTime > currentTime ){
 
 			/*
 			 * the wait interval has not passed,wait for the remainder of the interval before
-			 * checking for updates
+			 * checking for updates.The jitter is picked again so that machines started at the
+			 * same time do not all check at the saved time,see scheduleNextCheck()
 			 */
+			auto time = scheduledTime + utility::jitter( settings::updateCheckJitter() ) ;
 
-			auto t = new QTimer() ;
-
-			t->setSingleShot( true ) ;
-
-			connect( t,SIGNAL( timeout() ),t,SLOT( deleteLater() ) ) ;
-			connect( t,SIGNAL( timeout() ),this,SLOT( startTimer() ) ) ;
-
-			auto s = static_cast< int >( interval ) ;
-
-			t->start( s ) ;
+			m_timer.start( time ) ;
 
-			this->showToolTip( m_defaulticon,tr( "Status" ),s ) ;
+			this->showToolTip( m_defaulticon,tr( "Status" ),time - currentTime ) ;
 
 			this->logActivity( this->logMsg() ) ;
 		}else{
 			/*
-			 * the wait interval has passed.
+			 * the wait interval has passed,check for updates now.Only one check is made
+			 * however many were missed.
 			 */
-
-			/*
-			 * Calculate the time we are supposed to run next time.
-			 */
-
-			while( scheduledTime < currentTime ){
-
-				scheduledTime += m_sleepDuration ;
-			}
-
-			/*
-			 * Save the time we are supposed to run next.
-			 */
-			this->writeUpdateTimeToConfigFile( scheduledTime ) ;
-
-			auto t = new QTimer() ;
-
-			t->setSingleShot( true ) ;
-
-			connect( t,SIGNAL( timeout() ),t,SLOT( deleteLater() ) ) ;
-			connect( t,SIGNAL( timeout() ),this,SLOT( startTimer_1() ) ) ;
-
-			/*
-			 * Calculate time difference between now and next update check
-			 */
-			auto s = scheduledTime - currentTime ;
-
-			/*
-			 * Wait until the next time we run.
-			 */
-			t->start( static_cast< int >( s ) ) ;
-
-			/*
-			 * Check for updates.
-			 */
-			this->logActivity( tr( "Automatic check for updates initiated" ) ) ;
-
-			this->checkForUpdates() ;
+			this->automaticCheckForUpdates() ;
 		}
 	}
 }
 
-void qtUpdateNotifier::startTimer()
+/*
+ * The periodic check runs at "time" plus a random jitter that is picked again every time a
+ * check is scheduled.Only "time" is saved as the anchor of the schedule,saving the jittered
+ * time would let the jitter add up and the schedule drift later with every check.
+ */
+void qtUpdateNotifier::scheduleNextCheck( qint64 time )
 {
-	m_timer.stop() ;
-	m_timer.start( static_cast< int >( m_sleepDuration ) ) ;
-	this->automaticCheckForUpdates() ;
-}
+	this->writeUpdateTimeToConfigFile( time ) ;
 
-void qtUpdateNotifier::startTimer_1()
-{
-	m_timer.stop() ;
-	m_timer.start( static_cast< int >( m_sleepDuration ) ) ;
-	this->automaticCheckForUpdates() ;
+	m_timer.start( time + utility::jitter( settings::updateCheckJitter() ) ) ;
 }
 
 qint64 qtUpdateNotifier::getCurrentTime()
@@ -514,6 +393,14 @@ void qtUpdateNotifier::manualCheckForUpdates()
 {
 	this->logActivity( tr( "Manual check for updates initiated" ) ) ;
 
+	/*
+	 * A deferred automatic check is not needed after this one
+	 */
+	m_deferTimer.stop() ;
+
+	m_deferredSince = 0 ;
+	m_deferDelay    = 0 ;
+
 	if( settings::firstTimeRun() ){
 
 		settings::updateNextScheduledUpdateTime( this->getCurrentTime() + m_sleepDuration ) ;
@@ -525,15 +412,77 @@ void qtUpdateNotifier::manualCheckForUpdates()
 void qtUpdateNotifier::automaticCheckForUpdates()
 {
 	/*
-	 * since we are doing an automatic update,m_nextScheduledUpdateTime will have the same value as this->getCurrentTime()
+	 * The timer fires once however late it is,ie after the computer was suspended for longer
+	 * than the check interval,and the next check is at the first time on the schedule that is
+	 * still ahead
 	 */
+	auto s = qtUpdateNotifier::catchUp( m_nextScheduledUpdateTime,m_sleepDuration,this->getCurrentTime() + 1 ) ;
 
-	this->writeUpdateTimeToConfigFile( m_nextScheduledUpdateTime + m_sleepDuration ) ;
-	this->logActivity( tr( "Automatic check for updates initiated" ) ) ;
-	this->checkForUpdates() ;
+	this->scheduleNextCheck( s ) ;
+
+	this->checkForUpdatesWhenIdle() ;
+}
+
+/*
+ * An automatic check is put off while the computer is busy,running on battery or connected to
+ * a metered network.It is tried again after 5 minutes and then after twice as long every time,
+ * up to "deferCheckMaxDelayInMinutes",and it runs anyway once it was put off for a whole check
+ * interval.The periodic timer keeps running and so the schedule does not move.
+ */
+Task::coroutine qtUpdateNotifier::checkForUpdatesWhenIdle()
+{
+	if( m_deferTimer.isActive() || m_checkingIfIdle ){
+
+		/*
+		 * A deferred check is already waiting and it stands for this one too
+		 */
+		co_return ;
+	}
+
+	m_checkingIfIdle = true ;
+
+	auto reason = co_await utility::deferCheck() ;
+
+	m_checkingIfIdle = false ;
+
+	auto now = this->getCurrentTime() ;
+
+	if( !reason.isEmpty() && m_deferredSince == 0 ){
+
+		m_deferredSince = now ;
+	}
+
+	if( reason.isEmpty() || now - m_deferredSince >= m_sleepDuration ){
+
+		if( !reason.isEmpty() ){
+
+			this->logActivity( tr( "Update check was put off for too long, running it even though %1" ).arg( reason ) ) ;
+		}
+
+		m_deferredSince = 0 ;
+		m_deferDelay    = 0 ;
+
+		this->logActivity( tr( "Automatic check for updates initiated" ) ) ;
+
+		this->checkForUpdates() ;
+	}else{
+		auto maxDelay = std::max( settings::deferCheckMaxDelay(),60 * 1000 ) ;
+
+		m_deferDelay = std::min( m_deferDelay == 0 ? 5 * 60 * 1000 : 2 * m_deferDelay,maxDelay ) ;
+
+		auto m = QString::number( m_deferDelay / ( 60 * 1000 ) ) ;
+
+		auto e = tr( "Update check put off because %1, trying again in %2 minutes" ).arg( reason,m ) ;
+
+		this->logActivity( e ) ;
+
+		this->showToolTip( m_defaulticon,tr( "Status" ),e ) ;
+
+		m_deferTimer.start( m_deferDelay ) ;
+	}
 }
 
-void qtUpdateNotifier::checkForUpdates()
+Task::coroutine qtUpdateNotifier::checkForUpdates()
 {
 	if( m_threadIsRunning ){
 
@@ -545,7 +494,7 @@ void qtUpdateNotifier::checkForUpdates()
 
 		m_threadIsRunning = true ;
 
-		auto r = utility::reportUpdates().await() ;
+		auto r = co_await utility::reportUpdates() ;
 
 		m_threadIsRunning = false ;
 
@@ -590,7 +539,10 @@ void qtUpdateNotifier::checkForUpdates()
 
 			icon = m_defaulticon ;
 			m_statusicon.setStatus( statusicon::ItemStatus::Passive ) ;
-			this->showToolTip( icon,tr( "Check skipped, user is not connected to the internet" ) ) ;
+			/*
+			 * the reason the check was skipped,no connection or an open circuit breaker
+			 */
+			this->showToolTip( icon,r.taskOutput.at( 1 ) ) ;
 
 			break ;
 		case result::repoState::undefinedState :
@@ -632,23 +584,35 @@ void qtUpdateNotifier::saveAptGetLogOutPut( const result::array_t& l )
 	}
 }
 
-void qtUpdateNotifier::autoUpdatePackages()
+Task::coroutine qtUpdateNotifier::autoUpdatePackages()
 {
 	if( settings::autoUpdatePackages() ){
 
 		QString icon( "qt-update-notifier-updating" ) ;
 
-		this->showToolTip( icon,tr( "Status" ),tr( "Update in progress, do not power down computer" ) ) ;
+		auto title = tr( "Update in progress, do not power down computer" ) ;
+
+		this->showToolTip( icon,tr( "Status" ),title ) ;
 
 		m_statusicon.setStatus( statusicon::ItemStatus::NeedsAttention ) ;
 
 		this->logActivity( tr( "Automatic package update initiated" ) ) ;
 
-		auto r = utility::autoUpdatePackages().await() ;
+		auto r = co_await utility::autoUpdatePackages( this,[ this,title ]( const aptProgress& e ){
+
+			this->showAptProgress( title,e ) ;
+
+		} ) ;
+
+		emit aptGetProgress( QString() ) ;
 
 		if( r == 0 || r == 2 ){
 
 			this->showToolTip( m_defaulticon,tr( "Automatic package update completed" ) ) ;
+
+		}else if( r == utility::helperServiceBusy ){
+
+			this->showToolTip( m_defaulticon,tr( "Automatic package update skipped, another package update is in progress" ) ) ;
 		}else{
 			QString icon( "qt-update-notifier-important-info" ) ;
 			this->showToolTip( icon,tr( "Automatic package update failed" ) ) ;
@@ -661,7 +625,7 @@ void qtUpdateNotifier::autoUpdatePackages()
 	}
 }
 
-void qtUpdateNotifier::autoDownloadPackages()
+Task::coroutine qtUpdateNotifier::autoDownloadPackages()
 {
 	if( settings::autoDownloadPackages() ){
 
@@ -673,11 +637,25 @@ void qtUpdateNotifier::autoDownloadPackages()
 
 		this->logActivity( tr( "Packages downloading initiated" ) ) ;
 
-		if( utility::autoDownloadPackages().await() ){
+		auto title = tr( "Downloading packages" ) ;
+
+		auto r = co_await utility::autoDownloadPackages( this,[ this,title ]( const aptProgress& e ){
+
+			this->showAptProgress( title,e ) ;
+
+		} ) ;
+
+		emit aptGetProgress( QString() ) ;
+
+		if( r == 0 ){
 
 			this->showToolTip( icon,tr( "Downloading of packages completed" ) ) ;
 			m_statusicon.setStatus( statusicon::ItemStatus::NeedsAttention ) ;
 			this->autoUpdatePackages() ;
+
+		}else if( r == utility::helperServiceBusy ){
+
+			this->showToolTip( m_defaulticon,tr( "Downloading of packages skipped, another package update is in progress" ) ) ;
 		}else{
 			this->showToolTip( icon,tr( "Downloading of packages failed" ) ) ;
 		}
@@ -686,13 +664,68 @@ void qtUpdateNotifier::autoDownloadPackages()
 	}
 }
 
-void qtUpdateNotifier::checkForPackageUpdates()
+QString qtUpdateNotifier::aptStageName( const QString& e )
+{
+	if( e == "update" ){
+
+		return tr( "Refreshing package list" ) ;
+
+	}else if( e == "download" ){
+
+		return tr( "Downloading packages" ) ;
+
+	}else if( e == "simulate" ){
+
+		return tr( "Checking if it is safe to update" ) ;
+
+	}else if( e == "install" ){
+
+		return tr( "Installing packages" ) ;
+
+	}else if( e == "clean" ){
+
+		return tr( "Cleaning package cache" ) ;
+	}else{
+		return e ;
+	}
+}
+
+void qtUpdateNotifier::showAptProgress( const QString& title,const aptProgress& e )
+{
+	auto s = tr( "%1: %2%" ).arg( this->aptStageName( e.stage ),QString::number( e.percent ) ) ;
+
+	if( e.bytes > 0 ){
+
+		s += " " + tr( "(%1 MB fetched)" ).arg( QString::number( static_cast< double >( e.bytes ) / 1000000,'f',1 ) ) ;
+	}
+
+	if( !e.package.isEmpty() ){
+
+		s += "<br>" + e.package ;
+	}
+
+	this->showToolTip( "qt-update-notifier-updating",tr( "Status" ),title + "<br>" + s ) ;
+
+	emit aptGetProgress( QString( s ).replace( "<br>"," " ) ) ;
+}
+
+Task::coroutine qtUpdateNotifier::checkForPackageUpdates()
 {
 	if( settings::skipOldPackageCheck() ){
 
 		this->showToolTip( m_defaulticon,tr( "No updates found" ) ) ;
 	}else{
-		auto r = utility::checkForPackageUpdates().await() ;
+		auto l = co_await utility::checkForPackageUpdates() ;
+
+		QString r ;
+
+		for( const auto& it : l ){
+
+			if( !it.isEmpty() ){
+
+				r += "\n" + it ;
+			}
+		}
 
 		if( r.isEmpty() ){
 
@@ -708,7 +741,7 @@ void qtUpdateNotifier::checkForPackageUpdates()
 
 	if( settings::checkNewerKernels() ){
 
-		const auto& e = utility::checkKernelVersions().await() ;
+		auto e = co_await utility::checkKernelVersions() ;
 
 		if( !e.isEmpty() ){
 
@@ -735,7 +768,7 @@ void qtUpdateNotifier::showToolTip( const QString& x,const QString& y,const QStr
 	this->changeIcon( x ) ;
 }
 
-void qtUpdateNotifier::showToolTip( const QString& x,const QString& y,int z )
+void qtUpdateNotifier::showToolTip( const QString& x,const QString& y,qint64 z )
 {
 	QString n = tr( "Next update check will be at %1" ).arg( this->nextUpdateTime( z ) ) ;
 	m_statusicon.setToolTip( x,y,n ) ;
@@ -785,19 +818,22 @@ QString qtUpdateNotifier::nextAutoUpdateTime()
 
 	QDateTime d ;
 
-	if( a >= b ){
+	d.setMSecsSinceEpoch( qtUpdateNotifier::catchUp( a,m_sleepDuration,b ) ) ;
 
-		d.setMSecsSinceEpoch( a ) ;
-	}else{
-		while( a < b ){
+	return d.toString( Qt::TextDate ) ;
+}
 
-			a += m_sleepDuration ;
-		}
+/*
+ * The first time that is a whole number of "interval"s after "anchor" and is not before "now".
+ */
+qint64 qtUpdateNotifier::catchUp( qint64 anchor,qint64 interval,qint64 now )
+{
+	if( anchor >= now || interval <= 0 ){
 
-		d.setMSecsSinceEpoch( a ) ;
+		return anchor ;
+	}else{
+		return anchor + ( ( now - anchor + interval - 1 ) / interval ) * interval ;
 	}
-
-	return d.toString( Qt::TextDate ) ;
 }
 
 QString qtUpdateNotifier::logMsg( qint64 interval )
@@ -825,27 +861,23 @@ QString qtUpdateNotifier::logMsg( void )
 	return this->logMsg( this->nextScheduledUpdateTime() - this->getCurrentTime() ) ;
 }
 
-void qtUpdateNotifier::scheduleUpdates( int interval )
+void qtUpdateNotifier::scheduleUpdates( qint64 interval )
 {
 	this->logActivity( this->logMsg( interval ) ) ;
-	m_timer.stop() ;
-	m_timer.start( interval ) ;
+	m_timer.start( this->getCurrentTime() + interval ) ;
 }
 
-void qtUpdateNotifier::setUpdateInterval( int interval )
+void qtUpdateNotifier::setUpdateInterval( qint64 interval )
 {
 	this->logActivity( tr( "Rescheduling update check" ) ) ;
 
 	m_sleepDuration = interval ;
 
-	this->logActivity( this->logMsg( m_sleepDuration ) ) ;
-
-	this->writeUpdateTimeToConfigFile( this->getCurrentTime() + m_sleepDuration ) ;
+	this->scheduleNextCheck( this->getCurrentTime() + m_sleepDuration ) ;
 
-	auto d = static_cast<int>( m_sleepDuration ) ;
+	auto d = m_timer.deadline() - this->getCurrentTime() ;
 
-	m_timer.stop() ;
-	m_timer.start( d ) ;
+	this->logActivity( this->logMsg( d ) ) ;
 
 	auto x = m_defaulticon ;
 	auto y = m_statusicon.toolTipTitle() ;
@@ -53,6 +53,8 @@
 #include "settings.h"
 #include "statusicon.h"
 #include "twitter.h"
+#include "announcementfeed.h"
+#include "deadlinetimer.h"
 
 #include <memory>
 
@@ -71,40 +73,41 @@ signals:
 	void updateLogWindow( void ) ;
 	void configOptionsChanged_1( void ) ;
 	void msg( QString ) ;
+	void aptGetProgress( QString ) ;
 public slots:
-	void startUpdater( void ) ;
-	void setUpdateInterval( int ) ;
+	Task::coroutine startUpdater( void ) ;
+	void setUpdateInterval( qint64 ) ;
 private slots:
         void buildGUI( void ) ;
 	void run( void ) ;
 	void closeApp( int ) ;
 	void closeApp( void ) ;
 	void changeIcon( QString ) ;
-	void checkForUpdates( void ) ;
+	Task::coroutine checkForUpdates( void ) ;
+	Task::coroutine checkForUpdatesWhenIdle( void ) ;
 	void manualCheckForUpdates( void ) ;
 	void automaticCheckForUpdates( void ) ;
 	void checkForUpdatesOnStartUp( void ) ;
-	void scheduleUpdates( int ) ;
+	void scheduleUpdates( qint64 ) ;
 	void logWindowShow( void ) ;
 	void ignorePackageList( void ) ;
 	void aptGetLogWindow( void) ;
 	void doneUpdating( void ) ;
 	void toggleAutoStart( bool ) ;
 	void openConfigureDialog( void ) ;
-	void startTimer( void ) ;
-	void startTimer_1( void ) ;
 	void configOptionsChanged( void ) ;
 	void autoRefreshSynaptic( bool ) ;
 	void objectGone( QObject * ) ;
 	void checkTwitter( void ) ;
+	void announcement( QString ) ;
+	void announcementsUpdated( void ) ;
 private:
-	QString networResponse( QNetworkReply& ) ;
-	QString getLastTwitterUpdate( void ) ;
-	void setLastTwitterUpdate( const QString& ) ;
 	void showIconOnImportantInfo( void ) ;
-	void checkForPackageUpdates( void ) ;
-	void autoDownloadPackages( void ) ;
-	void autoUpdatePackages( void ) ;
+	Task::coroutine checkForPackageUpdates( void ) ;
+	Task::coroutine autoDownloadPackages( void ) ;
+	Task::coroutine autoUpdatePackages( void ) ;
+	void showAptProgress( const QString&,const aptProgress& ) ;
+	QString aptStageName( const QString& ) ;
 	void setupTranslationText( void ) ;
 	void printTime( const QString&,qint64 ) ;
 	void saveAptGetLogOutPut( const result::array_t& ) ;
@@ -114,28 +117,33 @@ private:
 	void writeUpdateTimeToConfigFile( qint64 ) ;
 	void showToolTip( const QString&,const QString&,const result::array_t& ) ;
 	void showToolTip( const QString&,const QString&,const QString& ) ;
-	void showToolTip( const QString&,const QString&,int ) ;
+	void showToolTip( const QString&,const QString&,qint64 ) ;
 	void showToolTip( const QString&,const QString& ) ;
 	QString nextUpdateTime( void ) ;
 	QString nextAutoUpdateTime( void ) ;
 	QString nextUpdateTime( qint64 ) ;
 	QString logMsg( qint64 ) ;
 	QString logMsg( void ) ;
+	void scheduleNextCheck( qint64 ) ;
+	static qint64 catchUp( qint64,qint64,qint64 ) ;
 	bool m_canCloseApplication ;
 	bool m_threadIsRunning ;
+	bool m_checkingIfIdle ;
 	bool m_autoStartEnabled ;
 	bool m_showIconOnImportantInfo ;
         bool m_autoStart ;
 	QStringList m_updatesList ;
-	QString m_url ;
 	QString m_networkConnectivityChecker ;
 	QString m_defaulticon ;
-	QString m_lastTwitterUpdate ;
-	QByteArray m_token ;
-	QTimer m_timer ;
+	deadlineTimer m_timer ;
 	qint64 m_sleepDuration ;
+	qint64 m_startUpDelay ;
+	QTimer m_deferTimer ;
+	qint64 m_deferredSince ;
+	int m_deferDelay ;
 	qint64 m_nextScheduledUpdateTime ;
 	NetworkAccessManager m_manager ;
+	announcementFeed m_feed ;
 	statusicon m_statusicon ;
 	bool m_debug ;
 	twitter m_twitter ;
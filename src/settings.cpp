@@ -23,8 +23,17 @@
 #include <cmath>
 #include <QSettings>
 #include <QDateTime>
+#include <QTimer>
+#include <QHash>
+#include <QVariant>
+#include <QFileSystemWatcher>
+#include <QCoreApplication>
+#include <QCryptographicHash>
 
 #include <functional>
+#include <mutex>
+#include <cstddef>
+#include <iterator>
 
 #include "tray_application_type.h"
 #include "settings.h"
@@ -39,53 +48,381 @@ static QString _configPath ;
 
 static QSettings * _settings ;
 
-static QString _localConfigDir( void )
+/*
+ * Options are read from the configuration file once,and again only when another program
+ * changed the file,and are served from "_snapshot".Changed options are collected in
+ * "_pending" and written back together by "_writeBack" a moment later.
+ *
+ * Getters are called from background tasks and the two are guarded by "_mutex",QSettings
+ * itself is only used in the GUI thread.
+ */
+enum class key : std::size_t
+{
+	language,
+	networkConnectivityChecker,
+	defaultIcon,
+	url,
+	nextScheduledUpdateTime,
+	lastAnnouncement,
+	announcementFeedPollInterval,
+	announcementFeedCursor,
+	updateCheckInterval,
+	startUpDelay,
+	updateCheckSplay,
+	updateCheckJitter,
+	deferCheckLoadPercent,
+	deferCheckPressurePercent,
+	deferCheckOnBattery,
+	deferCheckOnMeteredNetwork,
+	deferCheckMaxDelay,
+	autoRefreshSynaptic,
+	autoUpdatePackages,
+	autoDownloadPackages,
+	skipOldPackageCheck,
+	autoStartAtLogin,
+	warnOnInconsistentState,
+	prefixLogEntries,
+	showIconOnImportantInfo,
+	checkNewerKernels,
+	usePrivilegedHelperService,
+	backgroundCheckPolicy,
+	backgroundCheckMemoryLimit,
+	backgroundCheckTimeOut,
+	networkRetryAttempts,
+	networkRetryMaxDelay,
+	networkAttemptTimeOut,
+	networkCircuitBreakerCoolDown,
+	ignoredPackageList,
+	logWindowDimensions,
+	aptGetWindowDimensions,
+	size
+};
+
+struct option
+{
+	key id ;
+	const char * name ;
+};
+
+/*
+ * "lastTwitterUpdate" predates the announcement feed and is kept so that upgrading does not
+ * announce old items again.
+ */
+static constexpr option _options[] = {
+
+	{ key::language,"language" },
+	{ key::networkConnectivityChecker,"networkConnectivityChecker" },
+	{ key::defaultIcon,"defaultIcon" },
+	{ key::url,"url" },
+	{ key::nextScheduledUpdateTime,"nextScheduledUpdateTime0" },
+	{ key::lastAnnouncement,"lastTwitterUpdate" },
+	{ key::announcementFeedPollInterval,"announcementFeedPollIntervalInMinutes" },
+	{ key::announcementFeedCursor,"announcementFeedCursor" },
+	{ key::updateCheckInterval,"updateCheckInterval" },
+	{ key::startUpDelay,"startUpDelay" },
+	{ key::updateCheckSplay,"updateCheckSplayInSeconds" },
+	{ key::updateCheckJitter,"updateCheckJitterInSeconds" },
+	{ key::deferCheckLoadPercent,"deferCheckAboveLoadPercent" },
+	{ key::deferCheckPressurePercent,"deferCheckAbovePressurePercent" },
+	{ key::deferCheckOnBattery,"deferCheckOnBattery" },
+	{ key::deferCheckOnMeteredNetwork,"deferCheckOnMeteredNetwork" },
+	{ key::deferCheckMaxDelay,"deferCheckMaxDelayInMinutes" },
+	{ key::autoRefreshSynaptic,"autoRefreshSynaptic" },
+	{ key::autoUpdatePackages,"autoUpdatePackages" },
+	{ key::autoDownloadPackages,"autoDownloadPackages" },
+	{ key::skipOldPackageCheck,"skipOldPackageCheck" },
+	{ key::autoStartAtLogin,"autoStartAtLogin" },
+	{ key::warnOnInconsistentState,"warnOnInconsistentState" },
+	{ key::prefixLogEntries,"prefixLogEntries" },
+	{ key::showIconOnImportantInfo,"showIconOnImportantInfo" },
+	{ key::checkNewerKernels,"checkNewerKernels" },
+	{ key::usePrivilegedHelperService,"usePrivilegedHelperService" },
+	{ key::backgroundCheckPolicy,"backgroundCheckPolicy" },
+	{ key::backgroundCheckMemoryLimit,"backgroundCheckMemoryLimitInMB" },
+	{ key::backgroundCheckTimeOut,"backgroundCheckTimeOutInSeconds" },
+	{ key::networkRetryAttempts,"networkRetryAttempts" },
+	{ key::networkRetryMaxDelay,"networkRetryMaxDelayInSeconds" },
+	{ key::networkAttemptTimeOut,"networkAttemptTimeOutInSeconds" },
+	{ key::networkCircuitBreakerCoolDown,"networkCircuitBreakerCoolDownInMinutes" },
+	{ key::ignoredPackageList,"ignoredPackageList" },
+	{ key::logWindowDimensions,"logWindowDimensions" },
+	{ key::aptGetWindowDimensions,"aptGetWindowDimensions" }
+} ;
+
+static constexpr bool _inKeyOrder()
+{
+	for( std::size_t i = 0 ; i < std::size( _options ) ; i++ ){
+
+		if( _options[ i ].id != static_cast< key >( i ) ){
+
+			return false ;
+		}
+	}
+
+	return std::size( _options ) == static_cast< std::size_t >( key::size ) ;
+}
+
+static_assert( _inKeyOrder(),"_options must have one entry for every key,in the order of the keys" ) ;
+
+static QString _name( key e )
 {
-	return QString( "%1/%2" ).arg( QDir::homePath(),"/.config/" ) ;
+	return _options[ static_cast< std::size_t >( e ) ].name ;
 }
 
-static bool _option_bool( const QString& opt,bool e )
+/*
+ * Durations are kept in the unit they are stored in,the getters convert them.
+ */
+struct snapshot
+{
+	QString language ;
+	QString networkConnectivityChecker ;
+	QString defaultIcon ;
+	QString url ;
+	bool hasNextScheduledUpdateTime = false ;
+	qint64 nextScheduledUpdateTime = 0 ;
+	QString lastAnnouncement ;
+	int announcementFeedPollInterval = 0 ;
+	QString announcementFeedCursor ;
+	qint64 updateCheckInterval = 0 ;
+	int startUpDelay = 0 ;
+	qint64 updateCheckSplay = 0 ;
+	qint64 updateCheckJitter = 0 ;
+	int deferCheckLoadPercent = 0 ;
+	int deferCheckPressurePercent = 0 ;
+	bool deferCheckOnBattery = false ;
+	bool deferCheckOnMeteredNetwork = false ;
+	int deferCheckMaxDelay = 0 ;
+	bool autoRefreshSynaptic = false ;
+	bool autoUpdatePackages = false ;
+	bool autoDownloadPackages = false ;
+	bool skipOldPackageCheck = false ;
+	bool autoStartAtLogin = false ;
+	bool warnOnInconsistentState = false ;
+	bool prefixLogEntries = false ;
+	bool showIconOnImportantInfo = false ;
+	bool checkNewerKernels = false ;
+	bool usePrivilegedHelperService = false ;
+	QString backgroundCheckPolicy ;
+	qint64 backgroundCheckMemoryLimit = 0 ;
+	int backgroundCheckTimeOut = 0 ;
+	int networkRetryAttempts = 0 ;
+	int networkRetryMaxDelay = 0 ;
+	int networkAttemptTimeOut = 0 ;
+	int networkCircuitBreakerCoolDown = 0 ;
+	QStringList ignoredPackageList ;
+	QRect logWindowDimensions ;
+	QRect aptGetWindowDimensions ;
+};
+
+static std::mutex _mutex ;
+
+static snapshot _snapshot ;
+
+static QHash< QString,QVariant > _pending ;
+
+static QTimer * _writeBack ;
+
+static QFileSystemWatcher * _watcher ;
+
+/*
+ * Hash of the configuration file as it was after the last write back,a change notification
+ * for a file that still has it came from our own write.
+ */
+static QByteArray _writtenHash ;
+
+static QByteArray _fileHash( const QString& path )
 {
-	if( _settings->contains( opt ) ){
+	QFile f( path ) ;
+
+	if( f.open( QIODevice::ReadOnly ) ){
 
-		return _settings->value( opt,e ).toBool() ;
+		return QCryptographicHash::hash( f.readAll(),QCryptographicHash::Sha1 ) ;
 	}else{
-		_settings->setValue( opt,e ) ;
-		return e ;
+		return QByteArray() ;
 	}
 }
 
-static QString _option_qstring( const QString& opt,const QString& e )
+/*
+ * Must be called with "_mutex" held.
+ */
+static void _scheduleWriteBack( void )
 {
-	if( _settings->contains( opt ) ){
+	if( _writeBack ){
 
-		return _settings->value( opt ).toString() ;
-	}else{
-		_settings->setValue( opt,e ) ;
-		return e ;
+		/*
+		 * The timer belongs to the GUI thread and may only be started from it
+		 */
+		QMetaObject::invokeMethod( _writeBack,"start",Qt::QueuedConnection ) ;
 	}
 }
 
-static int _option_int( const QString& opt,int e,int multiply = 1000 )
+template< typename T >
+static void _read( key k,T& value,const T& defaultValue )
 {
-	if( _settings->contains( opt ) ){
+	auto name = _name( k ) ;
 
-		return multiply * _settings->value( opt ).toInt() ;
+	if( _settings->contains( name ) ){
+
+		value = _settings->value( name ).value< T >() ;
 	}else{
-		_settings->setValue( opt,QString::number( e ) ) ;
-		return multiply * e ;
+		value = defaultValue ;
+
+		_pending.insert( name,QVariant::fromValue( defaultValue ) ) ;
+	}
+}
+
+/*
+ * Must be called with "_mutex" held.
+ */
+static void _load( snapshot& s )
+{
+	_read( key::language,s.language,QString( "english_US" ) ) ;
+	_read( key::networkConnectivityChecker,s.networkConnectivityChecker,QString( "ping -c 1 8.8.8.8" ) ) ;
+	_read( key::defaultIcon,s.defaultIcon,QString( "qt-update-notifier" ) ) ;
+	_read( key::url,s.url,QString( _url ) ) ;
+	_read( key::lastAnnouncement,s.lastAnnouncement,QString() ) ;
+	_read( key::announcementFeedPollInterval,s.announcementFeedPollInterval,60 ) ;
+	_read( key::announcementFeedCursor,s.announcementFeedCursor,QString( "since_id" ) ) ;
+	_read( key::updateCheckInterval,s.updateCheckInterval,static_cast< qint64 >( 86400 ) ) ;
+	_read( key::startUpDelay,s.startUpDelay,300 ) ;
+	_read( key::updateCheckSplay,s.updateCheckSplay,static_cast< qint64 >( 900 ) ) ;
+	_read( key::updateCheckJitter,s.updateCheckJitter,static_cast< qint64 >( 0 ) ) ;
+	_read( key::deferCheckLoadPercent,s.deferCheckLoadPercent,100 ) ;
+	_read( key::deferCheckPressurePercent,s.deferCheckPressurePercent,20 ) ;
+	_read( key::deferCheckOnBattery,s.deferCheckOnBattery,true ) ;
+	_read( key::deferCheckOnMeteredNetwork,s.deferCheckOnMeteredNetwork,true ) ;
+	_read( key::deferCheckMaxDelay,s.deferCheckMaxDelay,60 ) ;
+	_read( key::autoRefreshSynaptic,s.autoRefreshSynaptic,false ) ;
+	_read( key::autoUpdatePackages,s.autoUpdatePackages,false ) ;
+	_read( key::autoDownloadPackages,s.autoDownloadPackages,false ) ;
+	_read( key::skipOldPackageCheck,s.skipOldPackageCheck,true ) ;
+	_read( key::autoStartAtLogin,s.autoStartAtLogin,true ) ;
+	_read( key::warnOnInconsistentState,s.warnOnInconsistentState,true ) ;
+	_read( key::prefixLogEntries,s.prefixLogEntries,true ) ;
+	_read( key::showIconOnImportantInfo,s.showIconOnImportantInfo,true ) ;
+	_read( key::checkNewerKernels,s.checkNewerKernels,false ) ;
+	_read( key::usePrivilegedHelperService,s.usePrivilegedHelperService,false ) ;
+	_read( key::backgroundCheckPolicy,s.backgroundCheckPolicy,QString( "idle" ) ) ;
+	_read( key::backgroundCheckMemoryLimit,s.backgroundCheckMemoryLimit,static_cast< qint64 >( 0 ) ) ;
+	_read( key::backgroundCheckTimeOut,s.backgroundCheckTimeOut,1800 ) ;
+	_read( key::networkRetryAttempts,s.networkRetryAttempts,3 ) ;
+	_read( key::networkRetryMaxDelay,s.networkRetryMaxDelay,60 ) ;
+	_read( key::networkAttemptTimeOut,s.networkAttemptTimeOut,120 ) ;
+	_read( key::networkCircuitBreakerCoolDown,s.networkCircuitBreakerCoolDown,15 ) ;
+	_read( key::ignoredPackageList,s.ignoredPackageList,QStringList() ) ;
+	_read( key::logWindowDimensions,s.logWindowDimensions,QRect( 332,188,701,380 ) ) ;
+	_read( key::aptGetWindowDimensions,s.aptGetWindowDimensions,QRect( 332,188,701,380 ) ) ;
+
+	/*
+	 * There is no default,its absence tells this is the first run
+	 */
+	auto name = _name( key::nextScheduledUpdateTime ) ;
+
+	s.hasNextScheduledUpdateTime = _settings->contains( name ) ;
+
+	if( s.hasNextScheduledUpdateTime ){
+
+		s.nextScheduledUpdateTime = _settings->value( name ).toLongLong() ;
+	}
+
+	if( !_pending.isEmpty() ){
+
+		_scheduleWriteBack() ;
 	}
 }
 
-static qint64 _option_longlong( const QString& opt,int e,int multiply = 1000 )
+static void _flush( void )
 {
-	if( _settings->contains( opt ) ){
+	QHash< QString,QVariant > pending ;
 
-		return multiply * _settings->value( opt ).toString().toLong() ;
-	}else{
-		_settings->setValue( opt,QString::number( e ) ) ;
-		return multiply * e ;
+	{
+		std::lock_guard< std::mutex > m( _mutex ) ;
+
+		pending.swap( _pending ) ;
+	}
+
+	if( pending.isEmpty() ){
+
+		return ;
+	}
+
+	for( auto it = pending.begin() ; it != pending.end() ; it++ ){
+
+		_settings->setValue( it.key(),it.value() ) ;
 	}
+
+	/*
+	 * QSettings writes the file to a temporary one and renames it over the old one
+	 */
+	_settings->sync() ;
+
+	auto path = _settings->fileName() ;
+
+	_writtenHash = _fileHash( path ) ;
+
+	if( _watcher && !_watcher->files().contains( path ) ){
+
+		_watcher->addPath( path ) ;
+	}
+}
+
+static void _reload( const QString& path )
+{
+	/*
+	 * A file replaced by a rename is no longer watched
+	 */
+	if( !_watcher->files().contains( path ) && QFile::exists( path ) ){
+
+		_watcher->addPath( path ) ;
+	}
+
+	if( _fileHash( path ) == _writtenHash ){
+
+		return ;
+	}
+
+	/*
+	 * Options changed here and not written yet are written first,they are newer than
+	 * the ones in the file
+	 */
+	_flush() ;
+
+	_settings->sync() ;
+
+	std::lock_guard< std::mutex > m( _mutex ) ;
+
+	_load( _snapshot ) ;
+}
+
+template< typename T >
+static T _get( T snapshot::* member )
+{
+	std::lock_guard< std::mutex > m( _mutex ) ;
+
+	return _snapshot.*member ;
+}
+
+template< typename T >
+static void _set( key k,T snapshot::* member,const T& value,const QVariant& stored )
+{
+	std::lock_guard< std::mutex > m( _mutex ) ;
+
+	_snapshot.*member = value ;
+
+	_pending.insert( _name( k ),stored ) ;
+
+	_scheduleWriteBack() ;
+}
+
+template< typename T >
+static void _set( key k,T snapshot::* member,const T& value )
+{
+	_set( k,member,value,QVariant::fromValue( value ) ) ;
+}
+
+static QString _localConfigDir( void )
+{
+	return QString( "%1/%2" ).arg( QDir::homePath(),"/.config/" ) ;
 }
 
 QString settings::aptGetLogFilePath()
@@ -114,6 +451,36 @@ void settings::init( QSettings * settings )
 
 	QDir d ;
 	d.mkpath( _configPath ) ;
+
+	auto app = QCoreApplication::instance() ;
+
+	_writeBack = new QTimer( app ) ;
+
+	_writeBack->setSingleShot( true ) ;
+	_writeBack->setInterval( 500 ) ;
+
+	QObject::connect( _writeBack,&QTimer::timeout,[](){ _flush() ; } ) ;
+
+	/*
+	 * Emitted when the event loop returns,options changed in the last half a second are
+	 * written here
+	 */
+	QObject::connect( app,&QCoreApplication::aboutToQuit,[](){ _flush() ; } ) ;
+
+	_watcher = new QFileSystemWatcher( app ) ;
+
+	QObject::connect( _watcher,&QFileSystemWatcher::fileChanged,[]( const QString& e ){ _reload( e ) ; } ) ;
+
+	auto path = _settings->fileName() ;
+
+	if( QFile::exists( path ) ){
+
+		_watcher->addPath( path ) ;
+	}
+
+	std::lock_guard< std::mutex > m( _mutex ) ;
+
+	_load( _snapshot ) ;
 }
 
 QString settings::configPath()
@@ -123,27 +490,27 @@ QString settings::configPath()
 
 QString settings::prefferedLanguage()
 {
-	return _option_qstring( "language","english_US" ) ;
+	return _get( &snapshot::language ) ;
 }
 
 void settings::setPrefferedLanguage( const QString& language )
 {
-        _settings->setValue( "language",language ) ;
+	_set( key::language,&snapshot::language,language ) ;
 }
 
 void settings::setCheckDelayOnStartUp( const QString& interval )
 {
-        _settings->setValue( "startUpDelay",interval ) ;
+	_set( key::startUpDelay,&snapshot::startUpDelay,interval.toInt(),interval ) ;
 }
 
 void settings::setNextUpdateInterval( const QString& interval )
 {
-        _settings->setValue( "updateCheckInterval",interval ) ;
+	_set( key::updateCheckInterval,&snapshot::updateCheckInterval,interval.toLongLong(),interval ) ;
 }
 
 QString settings::networkConnectivityChecker()
 {
-	return _option_qstring( "networkConnectivityChecker","ping -c 1 8.8.8.8" ) ;
+	return _get( &snapshot::networkConnectivityChecker ) ;
 }
 
 QString settings::delayTimeBeforeUpdateCheck( int time )
@@ -166,7 +533,7 @@ QString settings::delayTimeBeforeUpdateCheck( int time )
 
 QString settings::defaultIcon()
 {
-	return _option_qstring( "defaultIcon","qt-update-notifier" ) ;
+	return _get( &snapshot::defaultIcon ) ;
 }
 
 QByteArray settings::token()
@@ -176,177 +543,248 @@ QByteArray settings::token()
 
 QString settings::url()
 {
-	return _option_qstring( "url",_url ) ;
+	return _get( &snapshot::url ) ;
 }
 
 qint64 settings::nextScheduledUpdateTime()
 {
-	if( _settings->contains( "nextScheduledUpdateTime0" ) ){
+	std::unique_lock< std::mutex > m( _mutex ) ;
+
+	if( _snapshot.hasNextScheduledUpdateTime ){
 
-		return _settings->value( "nextScheduledUpdateTime0" ).toLongLong() ;
+		return _snapshot.nextScheduledUpdateTime ;
 	}else{
+		m.unlock() ;
+
 		qDebug() << "invalid code path in \"settings::nextScheduledUpdateTime()\"" ;
 
 		return QDateTime::currentDateTime().toMSecsSinceEpoch() ;
 	}
 }
 
-QString settings::getLastTwitterUpdate()
+QString settings::lastAnnouncement()
+{
+	return _get( &snapshot::lastAnnouncement ) ;
+}
+
+int settings::announcementFeedPollInterval()
+{
+	return 60 * 1000 * _get( &snapshot::announcementFeedPollInterval ) ;
+}
+
+QString settings::announcementFeedCursor()
 {
-	return _option_qstring( "lastTwitterUpdate",QString() ) ;
+	return _get( &snapshot::announcementFeedCursor ) ;
 }
 
 qint64 settings::updateCheckInterval()
 {
-	return _option_longlong( "updateCheckInterval",86400 ) ;
+	return 1000 * _get( &snapshot::updateCheckInterval ) ;
 }
 
 int settings::delayTimeBeforeUpdateCheck()
 {
-	return _option_int( "startUpDelay",300 ) ;
+	return 1000 * _get( &snapshot::startUpDelay ) ;
 }
 
-void settings::setLastTwitterUpdate( const QString& t )
+/*
+ * The window the checks of machines that start together are spread over,each machine gets a
+ * fixed place in it.
+ */
+qint64 settings::updateCheckSplay()
 {
-	QString opt( "lastTwitterUpdate" ) ;
-        _settings->setValue( opt,t ) ;
+	return 1000 * _get( &snapshot::updateCheckSplay ) ;
 }
 
-void settings::setAutoRefreshSynaptic( bool autoRefresh )
+/*
+ * A random delay of up to this much is added every time a check is scheduled.
+ */
+qint64 settings::updateCheckJitter()
 {
-	QString opt( "autoRefreshSynaptic" ) ;
+	return 1000 * _get( &snapshot::updateCheckJitter ) ;
+}
 
-	if( autoRefresh ){
+/*
+ * Automatic checks are put off while the load average is above this percentage of the number of
+ * CPUs,0 turns the test off.
+ */
+int settings::deferCheckLoadPercent()
+{
+	return _get( &snapshot::deferCheckLoadPercent ) ;
+}
 
-                _settings->setValue( opt,true ) ;
-	}else{
-                _settings->setValue( opt,false ) ;
-	}
+/*
+ * Automatic checks are put off while tasks were stalled on CPU or I/O for more than this
+ * percentage of the last 10 seconds,0 turns the test off.
+ */
+int settings::deferCheckPressurePercent()
+{
+	return _get( &snapshot::deferCheckPressurePercent ) ;
+}
+
+bool settings::deferCheckOnBattery()
+{
+	return _get( &snapshot::deferCheckOnBattery ) ;
+}
+
+bool settings::deferCheckOnMeteredNetwork()
+{
+	return _get( &snapshot::deferCheckOnMeteredNetwork ) ;
+}
+
+int settings::deferCheckMaxDelay()
+{
+	return 60 * 1000 * _get( &snapshot::deferCheckMaxDelay ) ;
+}
+
+void settings::setLastAnnouncement( const QString& t )
+{
+	_set( key::lastAnnouncement,&snapshot::lastAnnouncement,t ) ;
+}
+
+void settings::setAutoRefreshSynaptic( bool autoRefresh )
+{
+	_set( key::autoRefreshSynaptic,&snapshot::autoRefreshSynaptic,autoRefresh ) ;
 }
 
 bool settings::firstTimeRun()
 {
-	return !_settings->contains( "nextScheduledUpdateTime0" ) ;
+	return !_get( &snapshot::hasNextScheduledUpdateTime ) ;
 }
 
 void settings::updateNextScheduledUpdateTime( qint64 time )
 {
-	_settings->setValue( "nextScheduledUpdateTime0",QString::number( time ) ) ;
+	std::lock_guard< std::mutex > m( _mutex ) ;
+
+	_snapshot.hasNextScheduledUpdateTime = true ;
+	_snapshot.nextScheduledUpdateTime    = time ;
+
+	_pending.insert( _name( key::nextScheduledUpdateTime ),QString::number( time ) ) ;
+
+	_scheduleWriteBack() ;
 }
 
 bool settings::autoUpdatePackages()
 {
-	return _option_bool( "autoUpdatePackages",false ) ;
+	return _get( &snapshot::autoUpdatePackages ) ;
 }
 
 bool settings::autoRefreshSynaptic()
 {
-	return _option_bool( "autoRefreshSynaptic",false ) ;
+	return _get( &snapshot::autoRefreshSynaptic ) ;
 }
 
 bool settings::autoDownloadPackages()
 {
-	return _option_bool( "autoDownloadPackages",false ) ;
+	return _get( &snapshot::autoDownloadPackages ) ;
 }
 
 bool settings::skipOldPackageCheck()
 {
-	return _option_bool( "skipOldPackageCheck",true ) ;
+	return _get( &snapshot::skipOldPackageCheck ) ;
 }
 
 void settings::skipOldPackageCheck( bool e )
 {
-	_settings->setValue( "skipOldPackageCheck",e ) ;
+	_set( key::skipOldPackageCheck,&snapshot::skipOldPackageCheck,e ) ;
 }
 
 bool settings::autoStartEnabled()
 {
-	return _option_bool( "autoStartAtLogin",true ) ;
+	return _get( &snapshot::autoStartAtLogin ) ;
 }
 
 void settings::enableAutoStart( bool autoStart )
 {
-	QString opt( "autoStartAtLogin" ) ;
-	_settings->setValue( opt,autoStart ) ;
+	_set( key::autoStartAtLogin,&snapshot::autoStartAtLogin,autoStart ) ;
 }
 
 bool settings::warnOnInconsistentState()
 {
-	return _option_bool( "warnOnInconsistentState",true ) ;
+	return _get( &snapshot::warnOnInconsistentState ) ;
 }
 
 bool settings::prefixLogEntries()
 {
-	return _option_bool( "prefixLogEntries",true ) ;
+	return _get( &snapshot::prefixLogEntries ) ;
 }
 
 bool settings::showIconOnImportantInfo()
 {
-	return _option_bool( "showIconOnImportantInfo",true ) ;
+	return _get( &snapshot::showIconOnImportantInfo ) ;
 }
 
 bool settings::checkNewerKernels()
 {
-	return _option_bool( "checkNewerKernels",false ) ;
+	return _get( &snapshot::checkNewerKernels ) ;
 }
 
-QStringList settings::ignorePackageList()
+bool settings::usePrivilegedHelperService()
 {
-	if( _settings->contains( "ignoredPackageList" ) ){
-
-		return _settings->value( "ignoredPackageList" ).toStringList() ;
-	}else{
-		QStringList e ;
-		_settings->setValue( "ignoredPackageList",e ) ;
-		return e ;
-	}
+	return _get( &snapshot::usePrivilegedHelperService ) ;
 }
 
-void settings::ignorePackageList( const QStringList& e )
+QString settings::backgroundCheckPolicy()
 {
-	_settings->setValue( "ignoredPackageList",e ) ;
+	return _get( &snapshot::backgroundCheckPolicy ) ;
 }
 
-QRect settings::logWindowDimensions()
+qint64 settings::backgroundCheckMemoryLimit()
 {
-	if( !_settings->contains( "logWindowDimensions" ) ){
+	return 1024 * 1024 * _get( &snapshot::backgroundCheckMemoryLimit ) ;
+}
 
-		QRect r ;
+int settings::backgroundCheckTimeOut()
+{
+	return 1000 * _get( &snapshot::backgroundCheckTimeOut ) ;
+}
 
-		r.setX( 332 ) ;
-		r.setY( 188 ) ;
-		r.setWidth( 701 ) ;
-		r.setHeight( 380 ) ;
+int settings::networkRetryAttempts()
+{
+	return _get( &snapshot::networkRetryAttempts ) ;
+}
 
-		_settings->setValue( "logWindowDimensions",r ) ;
-	}
+int settings::networkRetryMaxDelay()
+{
+	return 1000 * _get( &snapshot::networkRetryMaxDelay ) ;
+}
 
-	return _settings->value( "logWindowDimensions" ).toRect() ;
+int settings::networkAttemptTimeOut()
+{
+	return 1000 * _get( &snapshot::networkAttemptTimeOut ) ;
 }
 
-void settings::logWindowDimensions( const QRect& e )
+int settings::networkCircuitBreakerCoolDown()
 {
-	_settings->setValue( "logWindowDimensions",e ) ;
+	return 60 * 1000 * _get( &snapshot::networkCircuitBreakerCoolDown ) ;
 }
 
-QRect settings::aptGetWindowDimensions()
+QStringList settings::ignorePackageList()
 {
-	if( !_settings->contains( "aptGetWindowDimensions" ) ){
+	return _get( &snapshot::ignoredPackageList ) ;
+}
 
-		QRect r ;
+void settings::ignorePackageList( const QStringList& e )
+{
+	_set( key::ignoredPackageList,&snapshot::ignoredPackageList,e ) ;
+}
 
-		r.setX( 332 ) ;
-		r.setY( 188 ) ;
-		r.setWidth( 701 ) ;
-		r.setHeight( 380 ) ;
+QRect settings::logWindowDimensions()
+{
+	return _get( &snapshot::logWindowDimensions ) ;
+}
 
-		_settings->setValue( "aptGetWindowDimensions",r ) ;
-	}
+void settings::logWindowDimensions( const QRect& e )
+{
+	_set( key::logWindowDimensions,&snapshot::logWindowDimensions,e ) ;
+}
 
-	return _settings->value( "aptGetWindowDimensions" ).toRect() ;
+QRect settings::aptGetWindowDimensions()
+{
+	return _get( &snapshot::aptGetWindowDimensions ) ;
 }
 
 void settings::aptGetWindowDimensions( const QRect& e )
 {
-	_settings->setValue( "aptGetWindowDimensions",e ) ;
+	_set( key::aptGetWindowDimensions,&snapshot::aptGetWindowDimensions,e ) ;
 }
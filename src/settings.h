@@ -39,9 +39,18 @@ namespace settings
 	QString defaultIcon( void ) ;
 	QByteArray token( void ) ;
 	QString url( void ) ;
-	QString getLastTwitterUpdate( void ) ;
-	void setLastTwitterUpdate( const QString& ) ;
+	QString lastAnnouncement( void ) ;
+	void setLastAnnouncement( const QString& ) ;
+	int announcementFeedPollInterval( void ) ;
+	QString announcementFeedCursor( void ) ;
 	int delayTimeBeforeUpdateCheck( void ) ;
+	qint64 updateCheckSplay( void ) ;
+	qint64 updateCheckJitter( void ) ;
+	int deferCheckLoadPercent( void ) ;
+	int deferCheckPressurePercent( void ) ;
+	bool deferCheckOnBattery( void ) ;
+	bool deferCheckOnMeteredNetwork( void ) ;
+	int deferCheckMaxDelay( void ) ;
 	bool autoRefreshSynaptic( void ) ;
 	bool firstTimeRun( void ) ;
 	qint64 updateCheckInterval( void ) ;
@@ -62,6 +71,14 @@ namespace settings
 	void setNextUpdateInterval( const QString& ) ;
 	QString networkConnectivityChecker( void ) ;
 	bool checkNewerKernels( void ) ;
+	bool usePrivilegedHelperService( void ) ;
+	QString backgroundCheckPolicy( void ) ;
+	qint64 backgroundCheckMemoryLimit( void ) ;
+	int backgroundCheckTimeOut( void ) ;
+	int networkRetryAttempts( void ) ;
+	int networkRetryMaxDelay( void ) ;
+	int networkAttemptTimeOut( void ) ;
+	int networkCircuitBreakerCoolDown( void ) ;
 	QStringList ignorePackageList( void ) ;
 	void ignorePackageList( const QStringList& ) ;
 	QRect logWindowDimensions( void ) ;
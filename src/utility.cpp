@@ -28,15 +28,26 @@
 #include <QFile>
 #include <QIODevice>
 #include <QVector>
+#include <QLocalSocket>
+#include <QCryptographicHash>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <fcntl.h>
+#include <sched.h>
 
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
 
+#include <mutex>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
 struct Result
 {
 	result m_result ;
@@ -114,6 +125,63 @@ bool writeToFile( const QString& filepath,const QString& content,bool truncate )
         }
 }
 
+/*
+ * The offset of this machine in a window of "max" milliseconds.It is derived from the machine id
+ * and so it does not change between boots and machines that boot together spread evenly over
+ * the window.
+ */
+qint64 splay( qint64 max )
+{
+	if( max <= 0 ){
+
+		return 0 ;
+	}
+
+	QByteArray id ;
+
+	for( const auto& it : { "/etc/machine-id","/var/lib/dbus/machine-id","/etc/hostname" } ){
+
+		QFile f( it ) ;
+
+		if( f.open( QIODevice::ReadOnly ) ){
+
+			id = f.readAll().trimmed() ;
+
+			if( !id.isEmpty() ){
+
+				break ;
+			}
+		}
+	}
+
+	/*
+	 * The id is hashed with the name of the program so that the offset does not match the one
+	 * of any other program that splays its work the same way
+	 */
+	auto s = QCryptographicHash::hash( "qt-update-notifier:" + id,QCryptographicHash::Sha256 ) ;
+
+	quint64 m = 0 ;
+
+	for( int i = 0 ; i < 8 ; i++ ){
+
+		m = ( m << 8 ) | static_cast< quint8 >( s.at( i ) ) ;
+	}
+
+	return static_cast< qint64 >( m % static_cast< quint64 >( max ) ) ;
+}
+
+qint64 jitter( qint64 max )
+{
+	if( max <= 0 ){
+
+		return 0 ;
+	}
+
+	static thread_local std::mt19937_64 random( std::random_device{}() ) ;
+
+	return std::uniform_int_distribution< qint64 >( 0,max - 1 )( random ) ;
+}
+
 QString readFromFile( const QString& filepath )
 {
         int fd = _openFile( filepath ) ;
@@ -234,6 +302,65 @@ static Result _processUpdates( QByteArray& output1,const QByteArray& output2 )
 	return Result{ { 0,result::repoState::updatesFound,{ updates,output2 } },upgrade,replace,New } ;
 }
 
+/*
+ * Update checks run in the background and should never compete with what the user is doing.
+ * With the "idle" policy,their processes only get CPU and disk time nobody else wants and
+ * can optionally be prevented from using more than a set amount of memory.
+ *
+ * The returned function runs in the child process between fork() and exec() and must
+ * therefore not touch anything that may not be safe to use there.
+ */
+static std::function< void() > _backgroundPolicy()
+{
+	if( settings::backgroundCheckPolicy() != "idle" ){
+
+		return [](){} ;
+	}
+
+	auto memoryLimit = static_cast< rlim_t >( settings::backgroundCheckMemoryLimit() ) ;
+
+	return [ memoryLimit ](){
+
+		struct sched_param param ;
+
+		param.sched_priority = 0 ;
+
+		sched_setscheduler( 0,SCHED_IDLE,&param ) ;
+
+		/*
+		 * IOPRIO_WHO_PROCESS on the calling process with IOPRIO_CLASS_IDLE
+		 */
+		syscall( SYS_ioprio_set,1,0,3 << 13 ) ;
+
+		if( memoryLimit > 0 ){
+
+			struct rlimit limit ;
+
+			limit.rlim_cur = memoryLimit ;
+			limit.rlim_max = memoryLimit ;
+
+			setrlimit( RLIMIT_AS,&limit ) ;
+		}
+	} ;
+}
+
+/*
+ * A check that hangs,ie apt-get waiting on a broken proxy,is terminated once its deadline passes
+ * so that it does not hold up all future checks.
+ */
+static Task::process::result _run( const QString& cmd,const Task::cancellation_token& token,
+				   const QProcessEnvironment& env = QProcessEnvironment() )
+{
+	return Task::process::run( cmd,{},token,-1,{},env,_backgroundPolicy() ).get() ;
+}
+
+static Task::process::result _run( const QString& cmd,const QProcessEnvironment& env = QProcessEnvironment() )
+{
+	Task::cancellation_token token( std::chrono::milliseconds( settings::backgroundCheckTimeOut() ) ) ;
+
+	return _run( cmd,token,env ) ;
+}
+
 static QByteArray _upgrade_0( const QString& configPath,bool setEnglishLanguage )
 {
 	auto e = QString( "apt-get -s -o Debug::NoLocking=true -o dir::state=%1/apt dist-upgrade" ).arg( configPath ) ;
@@ -245,9 +372,9 @@ static QByteArray _upgrade_0( const QString& configPath,bool setEnglishLanguage
 		env.insert( "LANG","en_US.UTF-8" ) ;
 		env.insert( "LANGUAGE","en_US.UTF-8:en_US:en" ) ;
 
-		return Task::process::run( e,{},-1,{},env ).get().std_out() ;
+		return _run( e,env ).std_out() ;
 	}else{
-		return Task::process::run( e ).get().std_out() ;
+		return _run( e ).std_out() ;
 	}
 }
 
@@ -261,6 +388,142 @@ static QByteArray _upgrade_1( const QString& configPath )
 	return _upgrade_0( configPath,false ) ;
 }
 
+/*
+ * A stage that failed in "_breakerFailures" checks in a row is skipped until the cool down passes
+ * so that a mirror that is down is not waited on by every check.The first check after the cool
+ * down runs the stage again.
+ */
+static const int _breakerFailures = 3 ;
+
+class circuitBreaker
+{
+public:
+	bool open()
+	{
+		std::lock_guard< std::mutex > m( m_mutex ) ;
+
+		return m_failures >= _breakerFailures && std::chrono::steady_clock::now() < m_openUntil ;
+	}
+	void failure()
+	{
+		std::lock_guard< std::mutex > m( m_mutex ) ;
+
+		if( ++m_failures >= _breakerFailures ){
+
+			auto s = std::chrono::milliseconds( settings::networkCircuitBreakerCoolDown() ) ;
+
+			m_openUntil = std::chrono::steady_clock::now() + s ;
+		}
+	}
+	void success()
+	{
+		std::lock_guard< std::mutex > m( m_mutex ) ;
+
+		m_failures = 0 ;
+	}
+private:
+	std::mutex m_mutex ;
+	int m_failures = 0 ;
+	std::chrono::steady_clock::time_point m_openUntil ;
+};
+
+static circuitBreaker _connectivityBreaker ;
+static circuitBreaker _updateBreaker ;
+
+/*
+ * How an attempt at a network operation ended.Only network failures,timeouts included,are
+ * retried and count against the circuit breaker,other failures like a repository with a bad
+ * signature would fail the same way again.
+ */
+enum class attempt{ succeeded,networkFailure,failed } ;
+
+static attempt _attempt( const Task::process::result& r,bool networkFailure )
+{
+	if( r.success() ){
+
+		return attempt::succeeded ;
+
+	}else if( networkFailure || !r.finished() ){
+
+		return attempt::networkFailure ;
+	}else{
+		return attempt::failed ;
+	}
+}
+
+/*
+ * apt-get update runs with an English locale and reports fetch errors on standard error
+ */
+static bool _aptNetworkFailure( const Task::process::result& r )
+{
+	static const char * errors[] = { "Could not resolve","Temporary failure resolving","Could not connect",
+					 "Unable to connect","Connection timed out","Connection failed",
+					 "Network is unreachable","No route to host","Connection refused" } ;
+
+	for( const auto& it : errors ){
+
+		if( r.std_error().contains( it ) || r.std_out().contains( it ) ){
+
+			return true ;
+		}
+	}
+
+	return false ;
+}
+
+/*
+ * Runs "function" until it succeeds,fails with something other than a network failure or was
+ * tried "networkRetryAttempts" times.The wait before the n-th retry is a random time between 0
+ * and min( networkRetryMaxDelay,2^n seconds ).
+ *
+ * Each attempt is cancelled after "networkAttemptTimeOutInSeconds" so that a hung attempt,ie
+ * apt-get behind a broken proxy,does not hold up the check for the whole check timeout,and all
+ * of them together do not run past "backgroundCheckTimeOutInSeconds".
+ */
+static bool _retry( circuitBreaker& breaker,const std::function< attempt( const Task::cancellation_token& ) >& function )
+{
+	using clock = std::chrono::steady_clock ;
+
+	auto attempts = settings::networkRetryAttempts() ;
+	auto maxDelay = settings::networkRetryMaxDelay() ;
+
+	auto deadline = clock::now() + std::chrono::milliseconds( settings::backgroundCheckTimeOut() ) ;
+
+	static thread_local std::mt19937 random( std::random_device{}() ) ;
+
+	for( int i = 1 ; ; i++ ){
+
+		auto m = clock::now() + std::chrono::milliseconds( settings::networkAttemptTimeOut() ) ;
+
+		auto r = function( Task::cancellation_token( std::min( m,deadline ) ) ) ;
+
+		if( r == attempt::succeeded ){
+
+			breaker.success() ;
+
+			return true ;
+		}
+
+		if( r == attempt::failed ){
+
+			return false ;
+		}
+
+		if( i >= attempts || clock::now() >= deadline ){
+
+			breaker.failure() ;
+
+			return false ;
+		}
+
+		auto cap = std::min( maxDelay,1000 << std::min( i,16 ) ) ;
+
+		auto s = std::uniform_int_distribution< int >( 0,cap )( random ) ;
+
+		std::this_thread::sleep_for( std::chrono::milliseconds( s ) ) ;
+	}
+}
+
 static bool _update( const QString& configPath )
 {
 	QProcessEnvironment env ;
@@ -270,14 +533,32 @@ static bool _update( const QString& configPath )
 
 	auto e = QString( "apt-get -s -o Debug::NoLocking=true -o dir::state=%1/apt update" ).arg( configPath ) ;
 
-	return Task::process::run( e,{},-1,{},env ).get().success() ;
+	return _retry( _updateBreaker,[ & ]( const Task::cancellation_token& token ){
+
+		auto r = _run( e,token,env ) ;
+
+		return _attempt( r,_aptNetworkFailure( r ) ) ;
+	} ) ;
 }
 
 static result _reportUpdates()
 {
+	if( _connectivityBreaker.open() || _updateBreaker.open() ){
+
+		return result{ 1,result::repoState::noNetworkConnection,{ "",QObject::tr( "Check skipped, repeated network failures, will try again later" ) } } ;
+	}
+
 	auto _not_online = [](){
 
-		return !Task::process::run( settings::networkConnectivityChecker() ).get().success() ;
+		auto s = settings::networkConnectivityChecker() ;
+
+		/*
+		 * the checker is there to test the connection,any failure of it is a network failure
+		 */
+		return !_retry( _connectivityBreaker,[ & ]( const Task::cancellation_token& token ){
+
+			return _attempt( _run( s,token ),true ) ;
+		} ) ;
 	}() ;
 
 	if( _not_online ){
@@ -351,7 +632,181 @@ If the problem persists and Synaptic is unable to solve it, then open a support
 
 Task::future< result >& reportUpdates()
 {
-	return Task::run( [](){ return _reportUpdates() ; } ) ;
+	return Task::run( Task::qos::background,[](){ return _reportUpdates() ; } ) ;
+}
+
+static QByteArray _readSystemFile( const QString& path )
+{
+	QFile f( path ) ;
+
+	if( f.open( QIODevice::ReadOnly ) ){
+
+		return f.readAll().trimmed() ;
+	}else{
+		return QByteArray() ;
+	}
+}
+
+static QString _loadReason()
+{
+	auto limit = settings::deferCheckLoadPercent() ;
+
+	auto cpus = std::max( 1u,std::thread::hardware_concurrency() ) ;
+
+	/*
+	 * /proc/loadavg: "0.52 0.58 0.59 1/467 12345",the first field is the one minute average
+	 */
+	bool ok ;
+
+	auto load = _readSystemFile( "/proc/loadavg" ).split( ' ' ).value( 0 ).toDouble( &ok ) ;
+
+	if( limit > 0 && ok && load * 100 > limit * cpus ){
+
+		return QObject::tr( "the system load is %1" ).arg( load ) ;
+	}else{
+		return QString() ;
+	}
+}
+
+static QString _pressureReason()
+{
+	auto limit = settings::deferCheckPressurePercent() ;
+
+	if( limit <= 0 ){
+
+		return QString() ;
+	}
+
+	/*
+	 * /proc/pressure/cpu: "some avg10=1.23 avg60=0.87 avg300=0.45 total=123456",missing on kernels
+	 * older than 4.20 or built without PSI
+	 */
+	for( const auto& it : { "cpu","io" } ){
+
+		auto lines = _readSystemFile( QString( "/proc/pressure/" ) + it ).split( '\n' ) ;
+
+		for( const auto& line : lines ){
+
+			if( !line.startsWith( "some " ) ){
+
+				continue ;
+			}
+
+			for( const auto& field : line.split( ' ' ) ){
+
+				if( field.startsWith( "avg10=" ) ){
+
+					auto s = field.mid( 6 ).toDouble() ;
+
+					if( s > limit ){
+
+						return QObject::tr( "%1 pressure is %2%" ).arg( it,QString::number( s ) ) ;
+					}
+				}
+			}
+		}
+	}
+
+	return QString() ;
+}
+
+static QString _batteryReason()
+{
+	if( !settings::deferCheckOnBattery() ){
+
+		return QString() ;
+	}
+
+	const QString path = "/sys/class/power_supply" ;
+
+	bool discharging = false ;
+
+	for( const auto& it : QDir( path ).entryList( QDir::Dirs | QDir::NoDotAndDotDot ) ){
+
+		auto e = path + "/" + it ;
+
+		auto type = _readSystemFile( e + "/type" ) ;
+
+		if( type == "Mains" || type == "USB" ){
+
+			if( _readSystemFile( e + "/online" ) == "1" ){
+
+				return QString() ;
+			}
+
+		}else if( type == "Battery" && _readSystemFile( e + "/scope" ) != "Device" ){
+
+			/*
+			 * Batteries of mice and other devices have their scope set to "Device"
+			 */
+			if( _readSystemFile( e + "/status" ) == "Discharging" ){
+
+				discharging = true ;
+			}
+		}
+	}
+
+	if( discharging ){
+
+		return QObject::tr( "the computer is running on battery" ) ;
+	}else{
+		return QString() ;
+	}
+}
+
+static QString _meteredReason()
+{
+	if( !settings::deferCheckOnMeteredNetwork() ){
+
+		return QString() ;
+	}
+
+	/*
+	 * NetworkManager's "Metered" property is about the connection that has the default route,
+	 * 1 is "yes" and 3 is "guessed yes",ie a phone that is used as a hotspot.The output is
+	 * "   variant       uint32 1".Without NetworkManager the test finds nothing.
+	 */
+	QStringList args{ "--system",
+			  "--print-reply=literal",
+			  "--dest=org.freedesktop.NetworkManager",
+			  "/org/freedesktop/NetworkManager",
+			  "org.freedesktop.DBus.Properties.Get",
+			  "string:org.freedesktop.NetworkManager",
+			  "string:Metered" } ;
+
+	auto r = Task::process::run( "dbus-send",args,5000 ).get() ;
+
+	if( r.success() ){
+
+		auto s = r.std_out().simplified().split( ' ' ) ;
+
+		auto m = s.isEmpty() ? 0 : s.last().toInt() ;
+
+		if( m == 1 || m == 3 ){
+
+			return QObject::tr( "the network connection is metered" ) ;
+		}
+	}
+
+	return QString() ;
+}
+
+Task::future< QString >& deferCheck()
+{
+	return Task::run( Task::qos::background,[](){
+
+		for( const auto& it : { _batteryReason,_loadReason,_pressureReason,_meteredReason } ){
+
+			auto e = it() ;
+
+			if( !e.isEmpty() ){
+
+				return e ;
+			}
+		}
+
+		return QString() ;
+	} ) ;
 }
 
 static int _task( const char * e )
@@ -363,7 +818,7 @@ static int _task( const char * e )
 
 Task::future< bool >& startSynaptic()
 {
-	return Task::run( [](){
+	return Task::run( Task::qos::interactive,[](){
 
 		auto run = [](){
 
@@ -379,14 +834,167 @@ Task::future< bool >& startSynaptic()
 	} ) ;
 }
 
-Task::future< bool >& autoDownloadPackages()
+static bool _parseProgress( const QByteArray& e,aptProgress& s )
+{
+	/*
+	 * line format: "progress <stage> <percent> <bytes> <package>"
+	 */
+	auto l = e.trimmed().split( ' ' ) ;
+
+	if( l.size() != 5 || l.at( 0 ) != "progress" ){
+
+		return false ;
+	}
+
+	s.stage   = l.at( 1 ) ;
+	s.percent = l.at( 2 ).toInt() ;
+	s.bytes   = l.at( 3 ).toLongLong() ;
+
+	if( l.at( 4 ) == "-" ){
+
+		s.package.clear() ;
+	}else{
+		s.package = l.at( 4 ) ;
+	}
+
+	return true ;
+}
+
+/*
+ * Ask qt-update-notifier-cli running as a helper service to do the work.
+ * Returns -1 if the service is not reachable.
+ *
+ * The service sends "alive" every 10 seconds while it serves the request,however long a step
+ * of apt-get runs without output,and we give up on it only after a minute without a line.
+ * A service that serves a request of somebody else answers with "exit 13" right away.
+ */
+static int _serviceTask( const char * e,const Task::typed_progress< aptProgress >& progress )
+{
+	QLocalSocket s ;
+
+	const int timeOut = 60 * 1000 ;
+
+	s.connectToServer( QT_UPDATE_NOTIFIER_HELPER_SOCKET ) ;
+
+	if( !s.waitForConnected( 1000 ) ){
+
+		return -1 ;
+	}
+
+	s.write( QByteArray( e ) + "\n" ) ;
+
+	s.waitForBytesWritten( timeOut ) ;
+
+	int r = 255 ;
+
+	bool exited = false ;
+
+	auto _report = [ & ](){
+
+		aptProgress p ;
+
+		while( s.canReadLine() ){
+
+			auto l = s.readLine() ;
+
+			if( l.startsWith( "exit " ) ){
+
+				r = l.mid( 5 ).trimmed().toInt() ;
+
+				exited = true ;
+
+			}else if( _parseProgress( l,p ) ){
+
+				progress.update( p ) ;
+			}
+		}
+	} ;
+
+	while( !exited && s.waitForReadyRead( timeOut ) ){
+
+		_report() ;
+	}
+
+	_report() ;
+
+	if( !exited && s.error() == QLocalSocket::SocketTimeoutError ){
+
+		qDebug() << "helper service did not respond for" << timeOut / 1000 << "seconds" ;
+	}
+
+	return r ;
+}
+
+static int _task( const char * e,const Task::typed_progress< aptProgress >& progress )
 {
-	return Task::run( [](){ return _task( "--download-packages" ) == 0 ; } ) ;
+	if( settings::usePrivilegedHelperService() ){
+
+		auto r = _serviceTask( e,progress ) ;
+
+		if( r != -1 ){
+
+			return r ;
+		}
+	}
+
+	QProcess exe ;
+
+	exe.setReadChannel( QProcess::StandardError ) ;
+
+	exe.start( QT_UPDATE_NOTIFIER_HELPER_PATH,{ e,"--progress" } ) ;
+
+	auto _report = [ & ](){
+
+		aptProgress s ;
+
+		while( exe.canReadLine() ){
+
+			if( _parseProgress( exe.readLine(),s ) ){
+
+				progress.update( s ) ;
+			}
+		}
+	} ;
+
+	if( !exe.waitForStarted( -1 ) ){
+
+		return 255 ;
+	}
+
+	while( exe.waitForReadyRead( -1 ) ){
+
+		_report() ;
+	}
+
+	exe.waitForFinished( -1 ) ;
+
+	_report() ;
+
+	return exe.exitCode() ;
+}
+
+/*
+ * apt-get can report progress many times a second,the tray is updated at most twice a second
+ * with the latest event.
+ */
+static const std::chrono::milliseconds _progressInterval( 500 ) ;
+
+Task::future< int >& autoDownloadPackages( QObject * obj,std::function< void( const aptProgress& ) > function )
+{
+	return Task::run< aptProgress >( obj,[]( const Task::typed_progress< aptProgress >& e ){
+
+		return _task( "--download-packages",e ) ;
+
+	},std::move( function ),_progressInterval ) ;
 }
 
-Task::future< int >& autoUpdatePackages()
+Task::future< int >& autoUpdatePackages( QObject * obj,std::function< void( const aptProgress& ) > function )
 {
-	return Task::run( [](){ return _task( "--auto-update" ) ; } ) ;
+	return Task::run< aptProgress >( obj,[]( const Task::typed_progress< aptProgress >& e ){
+
+		return _task( "--auto-update",e ) ;
+
+	},std::move( function ),_progressInterval ) ;
 }
 
 static bool _check_version( const QString& e,const QString& f )
@@ -463,7 +1071,7 @@ static bool _check_version( const QString& e,const QString& f )
 
 static QString _checkKernelVersion()
 {
-	QString version = Task::process::run( "uname -r" ).get().std_out() ;
+	QString version = _run( "uname -r" ).std_out() ;
 
 	int index = version.indexOf( "-" ) ;
 
@@ -531,7 +1139,7 @@ static QString _checkKernelVersion()
 
 static bool _updateAvailable( const QString& e,QString * newVersion,QString * installedVersion )
 {
-	QString r = Task::process::run( e ).get().std_out() ;
+	QString r = _run( e ).std_out() ;
 
 	if( r.isEmpty() ){
 
@@ -602,42 +1210,16 @@ static QString _checkCallibeVersion()
 	}
 }
 
-Task::future< QString >& checkForPackageUpdates()
+Task::future< std::vector< QString > >& checkForPackageUpdates()
 {
-	return Task::run( [](){
-
-		auto e = _checkKernelVersion() ;
-
-		decltype( e ) r ;
-
-		if( !e.isEmpty() ){
-
-			r += "\n" + e ;
-		}
-
-		e = _checkLibreOfficeVersion() ;
-
-		if( !e.isEmpty() ){
-
-			r += "\n" + e ;
-		}
-
-		e = _checkVirtualBoxVersion() ;
-
-		if( !e.isEmpty() ){
-
-			r += "\n" + e ;
-		}
-
-		e = _checkCallibeVersion() ;
-
-		if( !e.isEmpty() ){
-
-			r += "\n" + e ;
-		}
-
-		return r ;
-	} ) ;
+	/*
+	 * The probes are independent of each other and each one waits on a different program
+	 */
+	std::vector< std::reference_wrapper< Task::future< QString > > > e{ Task::run( Task::qos::background,_checkKernelVersion ),
+									    Task::run( Task::qos::background,_checkLibreOfficeVersion ),
+									    Task::run( Task::qos::background,_checkVirtualBoxVersion ),
+									    Task::run( Task::qos::background,_checkCallibeVersion ) } ;
+	return Task::when_all( e ) ;
 }
 
 static const auto e = R"R(
@@ -656,7 +1238,7 @@ fi
 
 Task::future<QString>& checkKernelVersions()
 {
-	return Task::run( []()->QString{
+	return Task::run( Task::qos::background,[]()->QString{
 
 		auto s = settings::configPath() + "/tmp" ;
 
@@ -679,7 +1261,7 @@ Task::future<QString>& checkKernelVersions()
 
 		f.setPermissions( QFile::ReadOwner | QFile::ExeOwner ) ;
 
-		return Task::process::run( exe ).get().std_out() ;
+		return _run( exe ).std_out() ;
 	} ) ;
 }
 
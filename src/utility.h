@@ -23,6 +23,8 @@
 #include <QString>
 #include <QStringList>
 #include <array>
+#include <vector>
+#include <functional>
 
 #include "task.hpp"
 
@@ -49,6 +51,18 @@ struct result
 	result::array_t taskOutput ;
 };
 
+/*
+ * A progress event reported by qt-update-notifier-cli while it runs apt-get.
+ * stage is one of "update","download","simulate","install" and "clean".
+ */
+struct aptProgress
+{
+	QString stage ;
+	int percent = 0 ;
+	qint64 bytes = 0 ;
+	QString package ;
+};
+
 namespace utility
 {
 	void waitForTwoSeconds( void ) ;
@@ -57,12 +71,25 @@ namespace utility
 
         QString readFromFile( const QString& filepath ) ;
 
+	qint64 splay( qint64 max ) ;
+	qint64 jitter( qint64 max ) ;
+
 	Task::future< result >& reportUpdates( void ) ;
-	Task::future< QString >& checkForPackageUpdates( void ) ;
+	/*
+	 * The reason an automatic update check should be put off,an empty string if there is none.
+	 */
+	Task::future< QString >& deferCheck( void ) ;
+	Task::future< std::vector< QString > >& checkForPackageUpdates( void ) ;
+
+	/*
+	 * Exit code of a package operation the helper service did not start because it was
+	 * serving another one.
+	 */
+	static const int helperServiceBusy = 13 ;
 
-	Task::future< int >& autoUpdatePackages( void ) ;
+	Task::future< int >& autoUpdatePackages( QObject *,std::function< void( const aptProgress& ) > ) ;
 
-	Task::future< bool >& autoDownloadPackages( void ) ;
+	Task::future< int >& autoDownloadPackages( QObject *,std::function< void( const aptProgress& ) > ) ;
 	Task::future< bool >& startSynaptic( void ) ;
 
 	Task::future< QString >& checkKernelVersions( void ) ;